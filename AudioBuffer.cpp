@@ -17,6 +17,7 @@
 #include "FFmpegHeaders.hpp"
 #include "AudioBuffer.hpp"
 #include <memory>
+#include <algorithm>
 
 #include <string.h>
 
@@ -199,6 +200,45 @@ AudioBuffer::write (const unsigned char * data, const int & bytesNb)
     return 0;
 }
 
+const unsigned int
+AudioBuffer::reserve (const unsigned int & bytesNb, unsigned char *& ptr1, unsigned int & size1, unsigned char *& ptr2, unsigned int & size2)
+{
+    ptr1 = NULL;
+    ptr2 = NULL;
+    size1 = 0;
+    size2 = 0;
+
+    if (m_Buffer == NULL)
+        return 0;
+    //
+    // Keep one byte free, because equal indicators mean empty buffer
+    //
+    const unsigned int  space = freeSpaceSize();
+    const unsigned int  total = std::min(bytesNb, space > 0 ? space - 1 : 0);
+    const unsigned int  tail  = m_bufferSize - m_endIndicator;
+
+    ptr1 = (unsigned char *)(m_Buffer + m_endIndicator);
+    size1 = std::min(total, tail);
+    if (total > size1)
+    {
+        ptr2 = (unsigned char *)m_Buffer;
+        size2 = total - size1;
+    }
+
+    return size1 + size2;
+}
+
+void
+AudioBuffer::commit (const unsigned int & bytesNb)
+{
+    if (bytesNb == 0)
+        return;
+    //
+    // After all, we can change \m_endIndicator
+    //
+    setEndIndicator ((m_endIndicator + bytesNb) % m_bufferSize);
+}
+
 const unsigned int
 AudioBuffer::freeSpaceSize() const
 {
@@ -51,8 +51,15 @@ public:
     // The only way to modify \m_startIndicator
     const unsigned long read (void * buffer, const int & bytesNb);
     //
-    // The only way to modify \m_endIndicator
+    // The only ways to modify \m_endIndicator
     const int           write (const unsigned char * buffer, const int & bytesNb);
+    //
+    // Exposes up to [bytesNb] of free space for writing without intermediate buffer.
+    // Free space could be wrapped around the end of buffer, so it is returned by two spans([size2] is ZERO if not wrapped).
+    // Returns total size of spans.
+    const unsigned int  reserve (const unsigned int & bytesNb, unsigned char *& ptr1, unsigned int & size1, unsigned char *& ptr2, unsigned int & size2);
+    // Makes available for reading [bytesNb] bytes, written to the spans of \reserve
+    void                commit (const unsigned int & bytesNb);
 
     const unsigned int  freeSpaceSize() const;
     const unsigned int  size() const;
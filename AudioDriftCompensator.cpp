@@ -0,0 +1,118 @@
+/* Improved ffmpeg plugin for OpenSceneGraph -
+ * Copyright (C) 2014-2015 Digitalis Education Solutions, Inc. (http://DigitalisEducation.com)
+ * File author: Oktay Radzhabov (oradzhabov at jazzros dot com)
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+#include "AudioDriftCompensator.hpp"
+#include <algorithm>
+
+namespace osgFFmpeg
+{
+
+const double AudioDriftCompensator::MaxCompensation = 0.005;
+
+namespace
+{
+// Sink fills its own buffers at start, so first seconds are not measured
+const double    WarmUpSec           = 2.0;
+// Drift is too noisy to be used during this time after warm-up
+const double    MinMeasureSec       = 20.0;
+// Time to remove accumulated lead/lag of audio
+const double    PhaseCorrectionSec  = 60.0;
+// Time constant of smoothing of the result
+const double    SmoothingSec        = 10.0;
+}
+
+AudioDriftCompensator::AudioDriftCompensator()
+:m_sampleRate(0),
+m_startMicros(-1.0),
+m_lastMicros(0.0),
+m_consumedSec(0.0),
+m_contentSec(0.0),
+m_compensation(0.0)
+{
+}
+
+void
+AudioDriftCompensator::reset(const unsigned int sampleRate)
+{
+    ScopedLock  lock (m_mutex);
+
+    m_sampleRate = sampleRate;
+    m_startMicros = -1.0;
+    m_compensation = 0.0;
+}
+
+void
+AudioDriftCompensator::restart()
+{
+    ScopedLock  lock (m_mutex);
+
+    m_startMicros = -1.0;
+}
+
+void
+AudioDriftCompensator::update(const unsigned long samplesNb)
+{
+    ScopedLock  lock (m_mutex);
+
+    if (m_sampleRate == 0)
+        return;
+
+    const double    curr_micros = m_timer.time_u();
+
+    if (m_startMicros < 0.0)
+    {
+        m_startMicros = curr_micros;
+        m_lastMicros = curr_micros;
+        m_consumedSec = 0.0;
+        m_contentSec = 0.0;
+        return;
+    }
+    const double    wallSec = (curr_micros - m_startMicros) / 1000000.0;
+    const double    dt      = (curr_micros - m_lastMicros) / 1000000.0;
+    m_lastMicros = curr_micros;
+    //
+    // Start measurement after warm-up
+    //
+    if (wallSec < WarmUpSec)
+        return;
+
+    const double    consumedSec = (double)samplesNb / (double)m_sampleRate;
+    m_consumedSec += consumedSec;
+    m_contentSec += consumedSec / (1.0 + m_compensation);
+
+    const double    measureSec = wallSec - WarmUpSec;
+    if (measureSec < MinMeasureSec)
+        return;
+    //
+    // Frequency: sink consumes faster than system clock if drift > 0, so output should be stretched.
+    // Phase: audio is ahead of system clock if [m_contentSec] > [measureSec]
+    //
+    const double    drift   = m_consumedSec / measureSec - 1.0;
+    const double    phase   = (m_contentSec - measureSec) / PhaseCorrectionSec;
+    const double    target  = std::max(-MaxCompensation, std::min(MaxCompensation, drift + phase));
+
+    m_compensation += (target - m_compensation) * std::min(1.0, dt / SmoothingSec);
+}
+
+const double
+AudioDriftCompensator::compensation() const
+{
+    ScopedLock  lock (m_mutex);
+
+    return m_compensation;
+}
+
+} // namespace osgFFmpeg
@@ -0,0 +1,66 @@
+/* Improved ffmpeg plugin for OpenSceneGraph -
+ * Copyright (C) 2014-2015 Digitalis Education Solutions, Inc. (http://DigitalisEducation.com)
+ * File author: Oktay Radzhabov (oradzhabov at jazzros dot com)
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+#ifndef HEADER_GUARD_FFMPEG_AUDIODRIFTCOMPENSATOR_H
+#define HEADER_GUARD_FFMPEG_AUDIODRIFTCOMPENSATOR_H
+
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
+#include <osg/Timer>
+
+namespace osgFFmpeg {
+
+//
+// Estimates drift between clock of the sound card and system clock by the rate
+// of samples consumed by audio sink. Result is the relative number of samples,
+// which resampler should add(positive) or remove(negative) to keep played audio
+// in sync with system clock, which drives the video.
+//
+// Estimation is PLL-like: frequency part is the average drift since the start of
+// measurement, phase part slowly removes the accumulated lead/lag of the audio.
+//
+class AudioDriftCompensator
+{
+    typedef OpenThreads::Mutex              Mutex;
+    typedef OpenThreads::ScopedLock<Mutex>  ScopedLock;
+
+    mutable Mutex                   m_mutex;
+    osg::Timer                      m_timer;
+    unsigned int                    m_sampleRate;
+    double                          m_startMicros;      // negative if measurement is not started
+    double                          m_lastMicros;
+    double                          m_consumedSec;      // consumed by sink, in sink's time
+    double                          m_contentSec;       // consumed by sink, in time of the source
+    double                          m_compensation;
+public:
+    // Max relative correction. 0.5% is not audible as pitch change
+    static const double             MaxCompensation;
+
+                                    AudioDriftCompensator();
+
+    // Forget estimation. Used when format of audio has been changed
+    void                            reset(const unsigned int sampleRate);
+    // Restart measurement, but keep current estimation. Used when playback is resumed or seeked
+    void                            restart();
+    // Audio thread reports [samplesNb] samples(of each channel) taken by sink
+    void                            update(const unsigned long samplesNb);
+
+    const double                    compensation() const;
+};
+
+} // namespace osgFFmpeg
+
+#endif // HEADER_GUARD_FFMPEG_AUDIODRIFTCOMPENSATOR_H
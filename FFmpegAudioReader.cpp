@@ -16,11 +16,13 @@
 
 #include "FFmpegAudioReader.hpp"
 #include "FFmpegParameters.hpp"
+#include "FFmpegMemorySource.hpp"
 #include <string>
 #include <osg/Timer>
 
 #include <stdexcept>
 #include <fstream>
+#include <algorithm>
 #include <sys/types.h>
 #include <sys/stat.h>
 
@@ -32,7 +34,7 @@ AVRational osg_get_time_base_q(void);
 const int
 FFmpegAudioReader::openFile(const char *filename, FFmpegParameters * parameters)
 {
-    int                     err, i;
+    int                     err;
     AVInputFormat *         iformat     = NULL;
     AVDictionary *          format_opts = NULL;
     AVFormatContext *       fmt_ctx     = NULL;
@@ -40,18 +42,11 @@ FFmpegAudioReader::openFile(const char *filename, FFmpegParameters * parameters)
     //
     //
     m_audioStreamIndex                  = -1;
-    m_output_buffer                     = NULL;
-    m_reader_buffer_shift               = 0;
-    m_output_buffer_length_prev         = 0;
-    m_FirstFrame                        = true;
-    m_input_currTime                    = 0.0;
-#ifdef USE_SWRESAMPLE
-    m_audio_swr_cntx                    = NULL;
-#else
-    m_audio_resample_cntx               = NULL;
-    m_audio_intermediate_resample_cntx  = NULL;
-#endif
     m_fmt_ctx_ptr                       = NULL;
+    m_demuxOwner                        = NULL;
+    m_prefetcher                        = NULL;
+    m_ownContext                        = NULL;
+    m_isQueueOverflow                   = false;
     //
     //
     //
@@ -90,6 +85,14 @@ FFmpegAudioReader::openFile(const char *filename, FFmpegParameters * parameters)
         // todo: should be tested for case when \parameters has values
         iformat = parameters ? parameters->getFormat() : 0;
         AVIOContext* context = parameters ? parameters->getContext() : 0;
+        //
+        // Memory source or memory-mapped local file is read by own IO context
+        //
+        if (context == NULL)
+        {
+            m_ownContext = FFmpegMemorySource::openContext(filename, parameters);
+            context = m_ownContext;
+        }
         if (context != NULL)
         {
             fmt_ctx = avformat_alloc_context();
@@ -107,10 +110,23 @@ FFmpegAudioReader::openFile(const char *filename, FFmpegParameters * parameters)
     {
         threadNb = atoi(dictEntry->value);
     }
+#ifdef OSG_INTERRUPT_CALLBACK
+    //
+    // Stop of prefetcher aborts its read, which is blocked by stalled network source
+    //
+    if (fmt_ctx == NULL)
+        fmt_ctx = avformat_alloc_context();
+    if (fmt_ctx != NULL)
+    {
+        fmt_ctx->interrupt_callback.callback = FFmpegPacketPrefetcher::interruptCallback;
+        fmt_ctx->interrupt_callback.opaque = & m_prefetcher;
+    }
+#endif // OSG_INTERRUPT_CALLBACK
 
     if ((err = avformat_open_input(&fmt_ctx, filename, iformat, &format_opts)) < 0)
     {
         OSG_NOTICE << "Cannot open file " << filename << " for audio" << std::endl;
+        FFmpegMemorySource::closeContext(& m_ownContext);
 
         return err;
     }
@@ -139,28 +155,178 @@ FFmpegAudioReader::openFile(const char *filename, FFmpegParameters * parameters)
 // version 53.7.0 (!)."
 #if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(53, 5, 0)
     if ((err = avformat_find_stream_info(fmt_ctx, NULL)) < 0)
-        return err;
 #else
     if ((err = av_find_stream_info(fmt_ctx)) < 0)
-        return err;
 #endif
+    {
+        closeInput(& fmt_ctx);
+        return err;
+    }
     av_dump_format(fmt_ctx, 0, filename, 0);
     //
-    // To find the first audio stream.
+    // To find the audio stream, selected by options or the first one.
     //
-    for (i = 0; i < (int)fmt_ctx->nb_streams; i++)
+    const int   streamIndex = findAudioStream(fmt_ctx, parameters);
+    if (streamIndex < 0)
+    {
+        av_log(NULL, AV_LOG_WARNING, "Opened file has not audio-streams");
+        closeInput(& fmt_ctx);
+        return -1;
+    }
+    if ((err = openStream(fmt_ctx, streamIndex, threadNb)) != 0)
+    {
+        m_fmt_ctx_ptr = NULL;
+        closeInput(& fmt_ctx);
+    }
+    return err;
+}
+
+void
+FFmpegAudioReader::closeInput(AVFormatContext ** fmt_ctx)
+{
+// see: https://gitorious.org/ffmpeg/sastes-ffmpeg/commit/5266045
+// "add avformat_close_input()."
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(53, 17, 0)
+    avformat_close_input(fmt_ctx);
+#else
+    av_close_input_file(* fmt_ctx);
+    * fmt_ctx = NULL;
+#endif
+    // Custom IO context is not freed by demuxer
+    FFmpegMemorySource::closeContext(& m_ownContext);
+}
+
+const int
+FFmpegAudioReader::openTrack(FFmpegAudioReader * owner, const int audioStreamNb)
+{
+    m_audioStreamIndex                  = -1;
+    m_fmt_ctx_ptr                       = NULL;
+    m_demuxOwner                        = NULL;
+    m_prefetcher                        = NULL;
+    m_ownContext                        = NULL;
+    m_isQueueOverflow                   = false;
+
+    // Prefetcher of the owner queues packets of already opened streams only
+    if (owner == NULL || owner->m_fmt_ctx_ptr == NULL || owner->m_demuxOwner != NULL || owner->m_prefetcher != NULL)
+        return -1;
+
+    AVFormatContext *       fmt_ctx     = owner->m_fmt_ctx_ptr;
+    int                     audioNb     = 0;
+    int                     streamIndex = -1;
+    for (unsigned int i = 0; i < fmt_ctx->nb_streams; ++i)
     {
         if (fmt_ctx->streams[i]->codec->codec_type == AVMEDIA_TYPE_AUDIO)
         {
-            m_audioStreamIndex = i;
-            break;
+            if (audioNb == audioStreamNb)
+            {
+                streamIndex = i;
+                break;
+            }
+            ++audioNb;
         }
     }
-    if (m_audioStreamIndex < 0)
+    if (streamIndex < 0)
     {
-        av_log(NULL, AV_LOG_WARNING, "Opened file has not audio-streams");
+        av_log(NULL, AV_LOG_WARNING, "Audio track %d is not available", audioStreamNb);
         return -1;
     }
+    // Stream is already decoded by the owner
+    if (streamIndex == owner->m_audioStreamIndex)
+        return -1;
+
+    const int   err = openStream(fmt_ctx, streamIndex, 1);
+    if (err != 0)
+    {
+        m_fmt_ctx_ptr = NULL;
+        return err;
+    }
+    m_demuxOwner = owner;
+    owner->m_tracks.push_back(this);
+
+    return 0;
+}
+
+const int
+FFmpegAudioReader::getAudioStreamNb(void) const
+{
+    int audioNb = 0;
+    for (unsigned int i = 0; i < m_fmt_ctx_ptr->nb_streams; ++i)
+    {
+        if (m_fmt_ctx_ptr->streams[i]->codec->codec_type == AVMEDIA_TYPE_AUDIO)
+            ++audioNb;
+    }
+    return audioNb;
+}
+
+const int
+FFmpegAudioReader::findAudioStream(AVFormatContext * fmt_ctx, FFmpegParameters * parameters)
+{
+    std::vector<int>        audioStreams;
+    for (unsigned int i = 0; i < fmt_ctx->nb_streams; ++i)
+    {
+        if (fmt_ctx->streams[i]->codec->codec_type == AVMEDIA_TYPE_AUDIO)
+            audioStreams.push_back(i);
+    }
+    if (audioStreams.empty())
+        return -1;
+
+    AVDictionary *          dict = parameters ? * parameters->getOptions() : NULL;
+    AVDictionaryEntry *     dictEntry;
+    //
+    // Language has priority over number of the stream
+    //
+    if ((dictEntry = av_dict_get(dict, "audio_language", NULL, 0)) != NULL)
+    {
+        for (size_t i = 0; i < audioStreams.size(); ++i)
+        {
+            AVDictionaryEntry * lang = av_dict_get(fmt_ctx->streams[audioStreams[i]]->metadata, "language", NULL, 0);
+            if (lang && av_strcasecmp(lang->value, dictEntry->value) == 0)
+                return audioStreams[i];
+        }
+        av_log(NULL, AV_LOG_WARNING, "Audio stream with language %s is not found", dictEntry->value);
+    }
+    if ((dictEntry = av_dict_get(dict, "audio_stream", NULL, 0)) != NULL)
+    {
+        const int   audioNb = atoi(dictEntry->value);
+        if (audioNb >= 0 && audioNb < (int)audioStreams.size())
+            return audioStreams[audioNb];
+
+        av_log(NULL, AV_LOG_WARNING, "Audio stream %d is not found", audioNb);
+    }
+
+    return audioStreams[0];
+}
+
+const int
+FFmpegAudioReader::openStream(AVFormatContext * fmt_ctx, const int streamIndex, const size_t threadNb)
+{
+    m_audioStreamIndex                  = streamIndex;
+    m_output_buffer                     = NULL;
+    m_reader_buffer_shift               = 0;
+    m_output_buffer_length_prev         = 0;
+#ifdef OSG_AUDIO_DIRECT_RESAMPLE
+    m_pFrame                            = NULL;
+#endif
+    m_FirstFrame                        = true;
+    m_input_currTime                    = 0.0;
+    m_seekTargetTime                    = -1.0;
+#ifdef OSG_SEND_RECEIVE_DECODE
+    m_frameTimestamp                    = AV_NOPTS_VALUE;
+#else
+    m_packetSamplesNb                   = 0;
+#endif // OSG_SEND_RECEIVE_DECODE
+    m_isCompensationEnabled             = false;
+    m_compensation                      = 0.0;
+    m_compensationRest                  = 0.0;
+    m_preloadedPos                      = 0;
+    m_preloaded.clear();
+#ifdef USE_SWRESAMPLE
+    m_audio_swr_cntx                    = NULL;
+#else
+    m_audio_resample_cntx               = NULL;
+    m_audio_intermediate_resample_cntx  = NULL;
+#endif
+
     AVCodecContext *pCodecCtx = fmt_ctx->streams[m_audioStreamIndex]->codec;
     // Check stream sanity
     if (pCodecCtx->codec_id == AV_CODEC_ID_NONE)
@@ -285,6 +451,7 @@ FFmpegAudioReader::isAudioPlanar () const
     return m_isSrcAudioPlanar;
 }
 
+#ifndef OSG_AUDIO_DIRECT_RESAMPLE
 // Audio should be planar
 const int
 FFmpegAudioReader::dePlaneAudio (const int & nb_samples, AVCodecContext * pCodecCtx, uint8_t **src_data)
@@ -377,6 +544,7 @@ FFmpegAudioReader::dePlaneAudio (const int & nb_samples, AVCodecContext * pCodec
 #endif // OSG_ABLE_PLANAR_AUDIO
     return -1;
 }
+#endif // OSG_AUDIO_DIRECT_RESAMPLE
 
 const int
 FFmpegAudioReader::calc_samples_get_buffer_size(const int & nb_samples, AVCodecContext * pCodecCtx)
@@ -395,7 +563,44 @@ const int
 FFmpegAudioReader::decodeAudio (int & buffer_size)
 {
     AVCodecContext *pCodecCtx   = m_fmt_ctx_ptr->streams[m_audioStreamIndex]->codec;
-#if LIBAVCODEC_VERSION_MAJOR >= 54
+#if defined(OSG_AUDIO_DIRECT_RESAMPLE)
+    //
+    // Decoded frame stays in \m_pFrame till the next call and will be fed to resampler as is
+    //
+    if (m_pFrame == NULL)
+    {
+        m_pFrame = OSG_ALLOC_FRAME();
+        if (m_pFrame == NULL)
+            return -1;
+    }
+
+#ifdef OSG_SEND_RECEIVE_DECODE
+    //
+    // Packets are sent by GetNextFrame(), here only the next frame is received
+    //
+    const int       result      = avcodec_receive_frame (pCodecCtx, m_pFrame);
+    const int       got_frame   = (result == 0);
+
+    if (got_frame)
+        m_frameTimestamp = m_pFrame->best_effort_timestamp;
+#else
+    int             got_frame   = 0;
+    const int       result      = avcodec_decode_audio4 (pCodecCtx, m_pFrame, & got_frame, & m_packet);
+#endif // OSG_SEND_RECEIVE_DECODE
+
+    if (result >= 0 && got_frame) // if no errors
+    {
+        buffer_size = calc_samples_get_buffer_size(m_pFrame->nb_samples, pCodecCtx);
+    }
+    else
+    {
+        buffer_size = 0;
+        if (result < 0)
+            buffer_size = -1;
+    }
+
+    return result;
+#elif LIBAVCODEC_VERSION_MAJOR >= 54
     AVFrame *       frame = OSG_ALLOC_FRAME();
     if (!frame)
         return -1;
@@ -403,7 +608,15 @@ FFmpegAudioReader::decodeAudio (int & buffer_size)
     int             got_frame   = 0;
     int             result;
 
+#ifdef OSG_SEND_RECEIVE_DECODE
+    result      = avcodec_receive_frame (pCodecCtx, frame);
+    got_frame   = (result == 0);
+
+    if (got_frame)
+        m_frameTimestamp = frame->best_effort_timestamp;
+#else
     result      = avcodec_decode_audio4 (pCodecCtx, frame, & got_frame, & m_packet);
+#endif // OSG_SEND_RECEIVE_DECODE
 
     if (result >= 0 && got_frame) // if no errors
     {
@@ -482,6 +695,156 @@ FFmpegAudioReader::decodeAudio (int & buffer_size)
 #endif
 }
 
+const bool
+FFmpegAudioReader::trimDecodedFrame(double & pts, int & buffer_size)
+{
+    if (m_seekTargetTime < 0.0)
+        return true;
+
+    AVCodecContext *    pCodecCtx   = m_fmt_ctx_ptr->streams[m_audioStreamIndex]->codec;
+    const int           sampleSize  = av_get_bytes_per_sample(pCodecCtx->sample_fmt);
+#ifdef OSG_AUDIO_DIRECT_RESAMPLE
+    const int           samplesNb   = m_pFrame->nb_samples;
+#else
+    const int           samplesNb   = buffer_size / (sampleSize * pCodecCtx->channels);
+#endif // OSG_AUDIO_DIRECT_RESAMPLE
+    const int           skipNb      = (int)((m_seekTargetTime - pts) * pCodecCtx->sample_rate + 0.5);
+
+    if (skipNb <= 0)
+    {
+        m_seekTargetTime = -1.0;
+        return true;
+    }
+    if (skipNb >= samplesNb)
+        return false;
+#ifdef OSG_AUDIO_DIRECT_RESAMPLE
+    //
+    // Resampler reads frame by its pointers, so they are moved to the target sample
+    //
+    if (isAudioPlanar())
+    {
+        for (int ch = 0; ch < pCodecCtx->channels; ++ch)
+            m_pFrame->extended_data[ch] += skipNb * sampleSize;
+    }
+    else
+    {
+        m_pFrame->extended_data[0] += skipNb * sampleSize * pCodecCtx->channels;
+    }
+    m_pFrame->nb_samples -= skipNb;
+    buffer_size = calc_samples_get_buffer_size(m_pFrame->nb_samples, pCodecCtx);
+#else
+    //
+    // Decode buffer keeps interleaved samples
+    //
+    const int           skipBytes   = skipNb * sampleSize * pCodecCtx->channels;
+
+    buffer_size -= skipBytes;
+    memmove(m_decode_buffer, m_decode_buffer + skipBytes, buffer_size);
+#endif // OSG_AUDIO_DIRECT_RESAMPLE
+    pts += (double)skipNb / pCodecCtx->sample_rate;
+    m_seekTargetTime = -1.0;
+
+    return true;
+}
+
+#ifdef OSG_SEND_RECEIVE_DECODE
+
+bool
+FFmpegAudioReader::GetNextFrame(double & currTime, int16_t * output_buffer, unsigned int & output_buffer_size)
+{
+    AVCodecContext *pCodecCtx   = m_fmt_ctx_ptr->streams[m_audioStreamIndex]->codec;
+    int             buffer_size;
+    //
+    // First time we're called, set m_packet.data to NULL to indicate it
+    // doesn't have to be freed
+    //
+    if(m_FirstFrame)
+    {
+        m_FirstFrame=false;
+        m_packet.data=NULL;
+        m_bytesRemaining = 0;
+    }
+    //
+    // Receive frames till decoder asks for more packets
+    //
+    while (true)
+    {
+        buffer_size = AVCODEC_MAX_AUDIO_FRAME_SIZE;
+
+        const int   receiveRez = decodeAudio (buffer_size);
+
+        if (receiveRez == 0 && buffer_size > 0)
+        {
+            double pts = 0;
+
+            if (m_frameTimestamp != AV_NOPTS_VALUE)
+                pts = m_frameTimestamp;
+            else
+                m_seekTargetTime = -1.0; // position of the frame is unknown, so it could not be trimmed
+
+            pts *= av_q2d(m_fmt_ctx_ptr->streams[m_audioStreamIndex]->time_base);
+#ifdef FFMPEG_DEBUG
+            av_log(NULL, AV_LOG_DEBUG, "pts: %f", pts);
+#endif // FFMPEG_DEBUG
+            //
+            // Seek lands before the target, so leading samples are decoded and dropped
+            //
+            if (trimDecodedFrame(pts, buffer_size) == false)
+                continue;
+
+            currTime = pts;
+#ifndef OSG_AUDIO_DIRECT_RESAMPLE
+            memcpy (output_buffer, m_decode_buffer, buffer_size/*value of this variable in bytes*/);
+#endif // OSG_AUDIO_DIRECT_RESAMPLE
+            output_buffer_size = buffer_size;
+
+            return true;
+        }
+        // All frames have been drained at the end of file
+        if (receiveRez == static_cast<int>(AVERROR_EOF))
+        {
+            output_buffer_size = 0;
+            return false;
+        }
+        // Broken packet is skipped, as decoding continues from the next one
+        if (receiveRez != AVERROR(EAGAIN))
+            av_log(NULL, AV_LOG_WARNING, "Error while decoding audio frame");
+
+        // Free old packet
+        if(m_packet.data != NULL)
+            av_free_packet(&m_packet);
+
+        // Read the next packet of this stream
+        const int   readPacketRez   = readPacket();
+        int         sendRez;
+
+        if(readPacketRez < 0)
+        {
+            if (isEndOfFile(readPacketRez))
+            {
+                // File(all streams) finished
+            }
+            else {
+                OSG_FATAL << "av_read_frame() returned " << AvStrError(readPacketRez) << std::endl;
+                throw std::runtime_error("av_read_frame() failed");
+            }
+            // Empty packet switches decoder to draining of delayed frames
+            m_packet.data = NULL;
+            sendRez = avcodec_send_packet (pCodecCtx, NULL);
+        }
+        else
+        {
+            sendRez = avcodec_send_packet (pCodecCtx, & m_packet);
+        }
+        if (sendRez < 0 && sendRez != static_cast<int>(AVERROR_EOF) && sendRez != AVERROR(EAGAIN))
+        {
+            av_log(NULL, AV_LOG_WARNING, "Error while sending audio packet to decoder");
+        }
+    }
+}
+
+#else // OSG_SEND_RECEIVE_DECODE
+
 bool
 FFmpegAudioReader::GetNextFrame(double & currTime, int16_t * output_buffer, unsigned int & output_buffer_size)
 {
@@ -521,17 +884,38 @@ FFmpegAudioReader::GetNextFrame(double & currTime, int16_t * output_buffer, unsi
             // Did we finish the current frame? Then we can return
             if (buffer_size > 0)
             {
-                double pts = 0;
+                AVCodecContext *    pCodecCtx   = m_fmt_ctx_ptr->streams[m_audioStreamIndex]->codec;
+#ifdef OSG_AUDIO_DIRECT_RESAMPLE
+                const int           samplesNb   = m_pFrame->nb_samples;
+#else
+                const int           samplesNb   = buffer_size / (av_get_bytes_per_sample(pCodecCtx->sample_fmt) * pCodecCtx->channels);
+#endif // OSG_AUDIO_DIRECT_RESAMPLE
+                double              pts         = 0;
 
                 if(m_packet.dts != AV_NOPTS_VALUE)
                     pts = m_packet.dts;
+                else
+                    m_seekTargetTime = -1.0; // position of the frame is unknown, so it could not be trimmed
 
+                //
+                // One packet may hold several frames, so each frame is placed after the samples decoded before it
+                //
                 pts *= av_q2d(m_fmt_ctx_ptr->streams[m_audioStreamIndex]->time_base);
+                pts += (double)m_packetSamplesNb / pCodecCtx->sample_rate;
+                m_packetSamplesNb += samplesNb;
 #ifdef FFMPEG_DEBUG
                 av_log(NULL, AV_LOG_DEBUG, "pts: %f", pts);
 #endif // FFMPEG_DEBUG
+                //
+                // Seek lands before the target, so leading samples are decoded and dropped
+                //
+                if (trimDecodedFrame(pts, buffer_size) == false)
+                    continue;
+
                 currTime = pts;
+#ifndef OSG_AUDIO_DIRECT_RESAMPLE
                 memcpy (output_buffer, m_decode_buffer, buffer_size/*value of this variable in bytes*/);
+#endif // OSG_AUDIO_DIRECT_RESAMPLE
                 output_buffer_size = buffer_size;
 
                 return true;
@@ -544,35 +928,30 @@ FFmpegAudioReader::GetNextFrame(double & currTime, int16_t * output_buffer, unsi
             }
         }
 
-        // Read the next packet, skipping all packets that aren't for this
-        // stream
-        do
-        {
-            // Free old packet
-            if(m_packet.data != NULL)
-                av_free_packet(&m_packet);
+        // Free old packet
+        if(m_packet.data != NULL)
+            av_free_packet(&m_packet);
 
-            // Read new packet
-            const int readPacketRez = av_read_frame(m_fmt_ctx_ptr, &m_packet);
+        // Read the next packet of this stream
+        const int readPacketRez = readPacket();
 
-            if(readPacketRez < 0)
+        if(readPacketRez < 0)
+        {
+            if (isEndOfFile(readPacketRez))
             {
-                if (readPacketRez == static_cast<int>(AVERROR_EOF) ||
-                    m_fmt_ctx_ptr->pb->eof_reached)
-                {
-                    // File(all streams) finished
-                }
-                else {
-                    OSG_FATAL << "av_read_frame() returned " << AvStrError(readPacketRez) << std::endl;
-                    throw std::runtime_error("av_read_frame() failed");
-                }
-
-                // End of stream. Done decoding.
-                return false;
+                // File(all streams) finished
+            }
+            else {
+                OSG_FATAL << "av_read_frame() returned " << AvStrError(readPacketRez) << std::endl;
+                throw std::runtime_error("av_read_frame() failed");
             }
-        } while(m_packet.stream_index != m_audioStreamIndex);
+
+            // End of stream. Done decoding.
+            return false;
+        }
 
         m_bytesRemaining=m_packet.size;
+        m_packetSamplesNb = 0;
     }
 
     // Decode the rest of the last frame
@@ -585,12 +964,140 @@ FFmpegAudioReader::GetNextFrame(double & currTime, int16_t * output_buffer, unsi
     return false;
 }
 
+#endif // OSG_SEND_RECEIVE_DECODE
+
+const int
+FFmpegAudioReader::readPacket()
+{
+    FFmpegAudioReader *     demuxer = (m_demuxOwner != NULL) ? m_demuxOwner : this;
+
+    if (m_packetQueue.empty())
+    {
+        //
+        // Read packets, skipping all packets that aren't for this stream.
+        // Packets of another opened tracks are queued for them.
+        //
+        while (true)
+        {
+            AVPacket        packet;
+            const int       rez = (demuxer->m_prefetcher != NULL) ?
+                                    demuxer->m_prefetcher->readFrame(& packet) :
+                                    av_read_frame(demuxer->m_fmt_ctx_ptr, & packet);
+
+            if (rez < 0)
+                return rez;
+
+            if (packet.stream_index == m_audioStreamIndex)
+            {
+                m_packet = packet;
+                return 0;
+            }
+            demuxer->dispatchPacket(packet);
+        }
+    }
+    m_packet = m_packetQueue.front();
+    m_packetQueue.pop_front();
+
+    return 0;
+}
+
+const bool
+FFmpegAudioReader::isEndOfFile(const int readRez) const
+{
+    const FFmpegAudioReader *   demuxer = (m_demuxOwner != NULL) ? m_demuxOwner : this;
+
+    if (readRez == static_cast<int>(AVERROR_EOF))
+        return true;
+    // I/O thread of prefetcher writes context of the demuxer
+    if (demuxer->m_prefetcher != NULL)
+        return demuxer->m_prefetcher->isEndOfFile();
+
+    return demuxer->m_fmt_ctx_ptr->pb && demuxer->m_fmt_ctx_ptr->pb->eof_reached;
+}
+
+void
+FFmpegAudioReader::dispatchPacket(AVPacket & packet)
+{
+    // Max number of packets waiting for the track. Sink of the track may be not attached, so queue is limited
+    static const size_t     MaxQueuedPackets = 1024;
+
+    FFmpegAudioReader *     target = NULL;
+
+    if (packet.stream_index == m_audioStreamIndex)
+        target = this;
+
+    for (size_t i = 0; target == NULL && i < m_tracks.size(); ++i)
+    {
+        if (packet.stream_index == m_tracks[i]->m_audioStreamIndex)
+            target = m_tracks[i];
+    }
+
+    if (target == NULL || av_dup_packet(& packet) < 0)
+    {
+        av_free_packet(& packet);
+        return;
+    }
+    //
+    // Tracks are read by the same thread as this reader, so it could not wait for them.
+    // Oldest packet is dropped, and overflow is reported.
+    //
+    if (target->m_packetQueue.size() >= MaxQueuedPackets)
+    {
+        if (target->m_isQueueOverflow == false)
+        {
+            av_log(NULL, AV_LOG_WARNING, "Packets of audio stream %d are dropped, because they are not read", (int)target->m_audioStreamIndex);
+            target->m_isQueueOverflow = true;
+        }
+        av_free_packet(& target->m_packetQueue.front());
+        target->m_packetQueue.pop_front();
+    }
+    else if (target->m_packetQueue.size() < MaxQueuedPackets / 2)
+    {
+        target->m_isQueueOverflow = false;
+    }
+    target->m_packetQueue.push_back(packet);
+}
+
+void
+FFmpegAudioReader::clearPacketQueue()
+{
+    while (m_packetQueue.empty() == false)
+    {
+        av_free_packet(& m_packetQueue.front());
+        m_packetQueue.pop_front();
+    }
+    m_isQueueOverflow = false;
+}
+
 int
 FFmpegAudioReader::seek(int64_t timestamp )
 {
+    if (m_preloaded.empty() == false)
+    {
+        const unsigned int  frameSize   = m_preloadedChannelsNb * av_get_bytes_per_sample(m_preloadedSampleFormat);
+        const size_t        sampleInd   = (size_t)((double)timestamp * m_preloadedSampleRate / 1000.0);
+
+        m_preloadedPos = std::min(m_preloaded.size(), sampleInd * frameSize);
+        m_input_currTime = (double)timestamp / 1000.0;
+        return 0;
+    }
     AVCodecContext *pCodecCtx = m_fmt_ctx_ptr->streams[m_audioStreamIndex]->codec;
     avcodec_flush_buffers(pCodecCtx);
-    const int seek_flags = (timestamp >= (int64_t)(m_input_currTime * 1000)) ? (AVSEEK_FLAG_ANY) : (AVSEEK_FLAG_ANY | AVSEEK_FLAG_BACKWARD);
+#ifdef USE_SWRESAMPLE
+    //
+    // Samples buffered by resampler belong to the previous position. Resampler is created again by next reading
+    //
+    if (m_audio_swr_cntx)
+    {
+        swr_free( & m_audio_swr_cntx);
+        m_audio_swr_cntx = NULL;
+    }
+#endif
+    //
+    // Seek lands on the packet preceding the target in both directions.
+    // Samples between that packet and the target are dropped after decoding.
+    //
+    const int seek_flags = AVSEEK_FLAG_ANY | AVSEEK_FLAG_BACKWARD;
     //
     m_input_currTime = (double)timestamp / 1000.0;
     //
@@ -607,11 +1114,23 @@ FFmpegAudioReader::seek(int64_t timestamp )
                                         osg_get_time_base_q(),
                                         m_fmt_ctx_ptr->streams[m_audioStreamIndex]->time_base);
 
+    m_seekTargetTime = seek_target * av_q2d(m_fmt_ctx_ptr->streams[m_audioStreamIndex]->time_base);
     m_FirstFrame = true;
 
+    clearPacketQueue();
     //
+    // Track shares demuxer of the owner, which seeks all of them
     //
-    const int seekVal = av_seek_frame(m_fmt_ctx_ptr, m_audioStreamIndex, seek_target, seek_flags);
+    if (m_demuxOwner != NULL)
+        return 0;
+
+    for (size_t i = 0; i < m_tracks.size(); ++i)
+        m_tracks[i]->clearPacketQueue();
+    //
+    //
+    const int seekVal = (m_prefetcher != NULL) ?
+                            m_prefetcher->seekFrame(m_audioStreamIndex, seek_target, seek_flags) :
+                            av_seek_frame(m_fmt_ctx_ptr, m_audioStreamIndex, seek_target, seek_flags);
     if (seekVal < 0)
     {
         av_log(NULL, AV_LOG_ERROR, "Cannot seek audio frame");
@@ -658,15 +1177,27 @@ void
 FFmpegAudioReader::close(void)
 {
     release_params_getSample();
+    clearPacketQueue();
+    std::vector<unsigned char>().swap(m_preloaded);
+    //
+    // Track does not own demuxer
+    //
+    if (m_demuxOwner != NULL)
+    {
+        std::vector<FFmpegAudioReader *> &  ownerTracks = m_demuxOwner->m_tracks;
+        ownerTracks.erase(std::remove(ownerTracks.begin(), ownerTracks.end(), this), ownerTracks.end());
 
-// see: https://gitorious.org/ffmpeg/sastes-ffmpeg/commit/5266045
-// "add avformat_close_input()."
-#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(53, 17, 0)
-    avformat_close_input(&m_fmt_ctx_ptr);
-#else
-    av_close_input_file(m_fmt_ctx_ptr);
-#endif
-
+        m_demuxOwner = NULL;
+        m_fmt_ctx_ptr = NULL;
+        return;
+    }
+    // I/O thread should not touch demuxer after closing
+    if (m_prefetcher != NULL)
+    {
+        delete m_prefetcher;
+        m_prefetcher = NULL;
+    }
+    closeInput(& m_fmt_ctx_ptr);
 }
 
 const int64_t
@@ -675,6 +1206,146 @@ FFmpegAudioReader::get_duration(void) const
     return m_fmt_ctx_ptr->duration * 1000 / AV_TIME_BASE; // milliseconds
 }
 
+const int
+FFmpegAudioReader::prefetch(const size_t & maxBytes, const double & maxDurationMS)
+{
+    //
+    // Track is read by prefetcher of the owner. Preloaded audio does not read the file.
+    //
+    if (m_demuxOwner != NULL || m_preloaded.empty() == false)
+        return -1;
+
+    if (m_prefetcher == NULL)
+    {
+        std::vector<int>    streams;
+
+        streams.push_back(m_audioStreamIndex);
+        for (size_t i = 0; i < m_tracks.size(); ++i)
+            streams.push_back(m_tracks[i]->m_audioStreamIndex);
+
+        m_prefetcher = new FFmpegPacketPrefetcher(m_fmt_ctx_ptr, streams, maxBytes, maxDurationMS);
+        m_prefetcher->Start();
+    }
+    return 0;
+}
+
+const int
+FFmpegAudioReader::getPrefetchStats(FFmpegPacketPrefetcher::Stats & stats) const
+{
+    const FFmpegAudioReader *   demuxer = (m_demuxOwner != NULL) ? m_demuxOwner : this;
+
+    if (demuxer->m_prefetcher == NULL)
+        return -1;
+
+    stats = demuxer->m_prefetcher->getStats();
+    return 0;
+}
+
+void
+FFmpegAudioReader::setCompensation(const double & compensation)
+{
+#ifdef OSG_AUDIO_DIRECT_RESAMPLE
+    //
+    // Resampler could be reinitialized by swr_set_compensation(), if it has been created
+    // as non-resampling one. To avoid it, enable compensation before creation of resampler.
+    //
+    m_isCompensationEnabled = true;
+    m_compensation = compensation;
+#endif // OSG_AUDIO_DIRECT_RESAMPLE
+}
+
+const int
+FFmpegAudioReader::preload(unsigned short channelsNb,
+                            const AVSampleFormat & output_sampleFormat,
+                            unsigned short sample_rate,
+                            const size_t & maxBytes)
+{
+    //
+    // Demuxer shared with another tracks or read by prefetcher could not be read ahead
+    //
+    if (m_demuxOwner != NULL || m_tracks.empty() == false || m_prefetcher != NULL)
+        return -1;
+
+    const unsigned int          frameSize       = channelsNb * av_get_bytes_per_sample(output_sampleFormat);
+    const unsigned long         blockSamples    = 4096;
+    std::vector<unsigned char>  pcm;
+    int                         err             = 0;
+
+    if (frameSize == 0 || seek(0) < 0)
+        return -1;
+    release_params_getSample();
+
+    while (true)
+    {
+        const size_t        offset          = pcm.size();
+        unsigned long       startTimeMS     = 0;
+        unsigned short      rate            = sample_rate;
+        unsigned long       samplesNb       = blockSamples;
+
+        if (offset + blockSamples * frameSize > maxBytes)
+        {
+            err = -1;
+            break;
+        }
+        pcm.resize(offset + blockSamples * frameSize);
+
+        const int           samplesRead     = getSamples(this, startTimeMS, channelsNb, output_sampleFormat, rate, samplesNb, & pcm[offset], -1.0);
+        if (samplesRead < 0)
+        {
+            err = samplesRead;
+            break;
+        }
+        pcm.resize(offset + samplesRead * frameSize);
+
+        if (samplesRead == 0)
+            break;
+    }
+    //
+    // Clip is too long or broken, so it is still decoded from the file
+    //
+    seek(0);
+    release_params_getSample();
+
+    if (err < 0 || pcm.empty())
+        return -1;
+
+    m_preloaded.swap(pcm);
+    m_preloadedPos = 0;
+    m_preloadedChannelsNb = channelsNb;
+    m_preloadedSampleFormat = output_sampleFormat;
+    m_preloadedSampleRate = sample_rate;
+
+    av_log(NULL, AV_LOG_INFO, "Preloaded %d bytes of audio", (int)m_preloaded.size());
+
+    return 0;
+}
+
+const int
+FFmpegAudioReader::getPreloadedSamples(unsigned short channelsNb,
+                                        const AVSampleFormat & output_sampleFormat,
+                                        unsigned short sample_rate,
+                                        unsigned long samplesNb,
+                                        unsigned char * bufSamples)
+{
+    if (channelsNb != m_preloadedChannelsNb ||
+        output_sampleFormat != m_preloadedSampleFormat ||
+        sample_rate != m_preloadedSampleRate)
+    {
+        av_log(NULL, AV_LOG_ERROR, "Format of preloaded audio differs from required one");
+        return -1;
+    }
+    const unsigned int  frameSize   = channelsNb * av_get_bytes_per_sample(output_sampleFormat);
+    const unsigned long samplesRead = std::min((size_t)samplesNb, (m_preloaded.size() - m_preloadedPos) / frameSize);
+
+    if (samplesRead == 0)
+        return 0;
+
+    memcpy(bufSamples, & m_preloaded[m_preloadedPos], samplesRead * frameSize);
+    m_preloadedPos += samplesRead * frameSize;
+
+    return samplesRead;
+}
+
 void
 FFmpegAudioReader::release_params_getSample(void)
 {
@@ -703,6 +1374,14 @@ FFmpegAudioReader::release_params_getSample(void)
         m_output_buffer = NULL;
     }
     m_output_buffer_length_prev = 0;
+    m_compensationRest = 0.0;
+#ifdef OSG_AUDIO_DIRECT_RESAMPLE
+    if (m_pFrame)
+    {
+        OSG_FREE_FRAME (& m_pFrame);
+        m_pFrame = NULL;
+    }
+#endif // OSG_AUDIO_DIRECT_RESAMPLE
 }
 
 const int
@@ -752,7 +1431,23 @@ FFmpegAudioReader::getSamples(FFmpegAudioReader* input_audio,
         //
         return -1;
     }
-
+    if (input_audio->m_preloaded.empty() == false)
+    {
+        return input_audio->getPreloadedSamples(output_channels,
+                                                output_sampleFormat,
+                                                output_FrameRate,
+                                                samplesNb,
+                                                bufSamples);
+    }
+#ifdef OSG_AUDIO_DIRECT_RESAMPLE
+    return getSamplesDirect(input_audio,
+                            output_channels,
+                            output_sampleFormat,
+                            output_FrameRate,
+                            samplesNb,
+                            bufSamples,
+                            max_avail_time_micros);
+#else
     osg::Timer              loc_timer;
     const double            start_timer_micros      = loc_timer.time_u();
     //
@@ -820,7 +1515,14 @@ FFmpegAudioReader::getSamples(FFmpegAudioReader* input_audio,
             if (readed_from_decoder > 0)
                 input_buffer_size = readed_from_decoder;
             else
+            {
+#ifdef USE_SWRESAMPLE
+                // End of stream. Take the rest of resampler
+                if (input_audio->m_audio_swr_cntx != NULL)
+                    return std::max(0, swr_convert(input_audio->m_audio_swr_cntx, (uint8_t**)(&bufSamples), samplesNb, NULL, 0));
+#endif
                 break;
+            }
         }
         else
         {
@@ -946,6 +1648,128 @@ FFmpegAudioReader::getSamples(FFmpegAudioReader* input_audio,
         }
     }
     return 0;
+#endif // OSG_AUDIO_DIRECT_RESAMPLE
+}
+
+#ifdef OSG_AUDIO_DIRECT_RESAMPLE
+const int
+FFmpegAudioReader::getSamplesDirect(FFmpegAudioReader* input_audio,
+                        unsigned short output_channels,
+                        const AVSampleFormat & output_sampleFormat,
+                        unsigned short & output_FrameRate,
+                        unsigned long & samplesNb,
+                        unsigned char * bufSamples,
+                        const double & max_avail_time_micros)
+{
+    osg::Timer              loc_timer;
+    const double            start_timer_micros      = loc_timer.time_u();
+    //
+    AVCodecContext *        pCodecCtx               = input_audio->m_fmt_ctx_ptr->streams[input_audio->m_audioStreamIndex]->codec;
+    const int               input_FrameRate         = input_audio->getFrameRate();
+    const int               input_Channels          = input_audio->getChannels();
+    const int               output_sample_size      = av_get_bytes_per_sample (output_sampleFormat) * output_channels;
+    //
+    // Resampler takes native format of decoder, which could be planar
+    //
+    if (input_audio->m_audio_swr_cntx == NULL)
+    {
+        const int output_layout                     = guessLayoutByChannelsNb(output_channels);
+        // Fix when layout is not set.
+        const int input_layout                      = pCodecCtx->channel_layout == 0 ? guessLayoutByChannelsNb(input_Channels) : pCodecCtx->channel_layout;
+
+        input_audio->m_audio_swr_cntx = swr_alloc_set_opts(NULL,
+                                            output_layout, output_sampleFormat, output_FrameRate,
+                                            input_layout, pCodecCtx->sample_fmt, input_FrameRate,
+                                            0, NULL);
+        if (input_audio->m_audio_swr_cntx == NULL)
+            return -1;
+
+        if (input_audio->m_isCompensationEnabled)
+            av_opt_set_int(input_audio->m_audio_swr_cntx, "flags", SWR_FLAG_RESAMPLE, 0);
+
+        if (swr_init(input_audio->m_audio_swr_cntx) != 0)
+        {
+            av_log(NULL, AV_LOG_ERROR, "Cannot init resampler for audio");
+            swr_free( & input_audio->m_audio_swr_cntx);
+            return -1;
+        }
+    }
+    //
+    // Clock drift compensation is spread over the required output samples.
+    // Fractional part of samples is kept for the next call.
+    //
+    if (input_audio->m_isCompensationEnabled)
+    {
+        input_audio->m_compensationRest += input_audio->m_compensation * samplesNb;
+
+        const int   sample_delta = (int)input_audio->m_compensationRest;
+        input_audio->m_compensationRest -= sample_delta;
+
+        swr_set_compensation(input_audio->m_audio_swr_cntx, sample_delta, samplesNb);
+    }
+    //
+    // Convert decoded frames till output is full. If frame is bigger than free space of output,
+    // the rest of frame is buffered by resampler and will be returned by the next call.
+    //
+    unsigned long           produced = 0;
+    unsigned int            decoded_size;
+    while (produced < samplesNb)
+    {
+        uint8_t *           out = bufSamples + produced * output_sample_size;
+        int                 rc;
+        //
+        // Samples buffered by resampler are taken first, so it does not grow by frames which did not fit
+        // into the short span of the ring. Empty input is not NULL, because NULL flushes resampler.
+        //
+        const uint8_t *     noInput[128] = { 0 }; // one pointer per plane
+
+        rc = swr_convert(input_audio->m_audio_swr_cntx,
+                        & out,
+                        samplesNb - produced,
+                        noInput,
+                        0);
+        if (rc > 0)
+        {
+            produced += rc;
+            continue;
+        }
+
+        if (input_audio->GetNextFrame(input_audio->m_input_currTime, NULL, decoded_size) == true)
+        {
+            rc = swr_convert(input_audio->m_audio_swr_cntx,
+                            & out,
+                            samplesNb - produced,
+                            (const uint8_t**)input_audio->m_pFrame->extended_data,
+                            input_audio->m_pFrame->nb_samples);
+        }
+        else
+        {
+            // End of stream. Take the rest of resampler
+            rc = swr_convert(input_audio->m_audio_swr_cntx,
+                            & out,
+                            samplesNb - produced,
+                            NULL,
+                            0);
+            if (rc > 0)
+                produced += rc;
+            break;
+        }
+        if (rc < 0)
+        {
+            av_log(NULL, AV_LOG_ERROR, "Cannot resample audio");
+            return -1;
+        }
+        produced += rc;
+        //
+        // If spent time more than available(if defined, i.e. \max_avail_time_micros > 0.0)
+        //
+        const double    ellapsed_time_micros = loc_timer.time_u() - start_timer_micros;
+        if (produced > 0 && max_avail_time_micros > 0.0 && ellapsed_time_micros > max_avail_time_micros)
+            break;
+    }
+
+    return produced;
 }
+#endif // OSG_AUDIO_DIRECT_RESAMPLE
 
 } // namespace osgFFmpeg
@@ -18,6 +18,9 @@
 #define HEADER_GUARD_FFMPEG_AUDIOREADER_H
 
 #include "FFmpegHeaders.hpp"
+#include "FFmpegPacketPrefetcher.hpp"
+#include <deque>
+#include <vector>
 
 namespace osgFFmpeg {
 
@@ -71,12 +74,22 @@ private:
 #endif
     unsigned long           m_output_buffer_length_prev;
     unsigned int            m_reader_buffer_shift;
+#ifdef OSG_AUDIO_DIRECT_RESAMPLE
+    AVFrame *               m_pFrame;
+#else
     int8_t                  m_decode_buffer[AVCODEC_MAX_AUDIO_FRAME_SIZE];
 #ifdef OSG_ABLE_PLANAR_AUDIO
     int8_t                  m_decode_panar_buffer[AVCODEC_MAX_AUDIO_FRAME_SIZE];
 #endif
+#endif // OSG_AUDIO_DIRECT_RESAMPLE
     //
     AVFormatContext *       m_fmt_ctx_ptr;
+    FFmpegAudioReader *     m_demuxOwner;           // reader, which owns \m_fmt_ctx_ptr. NULL if it is this reader
+    std::vector<FFmpegAudioReader *>    m_tracks;   // readers of another audio streams, fed by demuxer of this reader
+    FFmpegPacketPrefetcher *    m_prefetcher;       // reads demuxer ahead. NULL if demuxer is read directly
+    AVIOContext *           m_ownContext;           // IO context of memory source or memory-mapped file. NULL if file is opened by demuxer
+    std::deque<AVPacket>    m_packetQueue;          // packets demuxed but not decoded yet
+    bool                    m_isQueueOverflow;      // queue is full, so oldest packets are dropped. Reported once per overflow
     short                   m_audioStreamIndex;
     bool                    m_FirstFrame;
     int                     m_bytesRemaining;
@@ -84,16 +97,66 @@ private:
     bool                    m_isSrcAudioPlanar;
     AVSampleFormat          m_outSampleFormat;
     double                  m_input_currTime;
+    double                  m_seekTargetTime;       // Decoded samples before this stream time(in seconds) are dropped. Negative if seek is completed
+#ifdef OSG_SEND_RECEIVE_DECODE
+    int64_t                 m_frameTimestamp;       // best effort timestamp of the last decoded frame, in time base of the stream
+#else
+    int64_t                 m_packetSamplesNb;      // samples already decoded from \m_packet, as its frames share dts of the packet
+#endif // OSG_SEND_RECEIVE_DECODE
+    bool                    m_isCompensationEnabled;
+    double                  m_compensation;
+    double                  m_compensationRest;     // fractional part of samples, which are not compensated yet
+    //
+    // Fully decoded audio of short clip. If empty, audio is decoded from the file
+    //
+    std::vector<unsigned char>  m_preloaded;
+    size_t                  m_preloadedPos;         // read position in \m_preloaded, in bytes
+    unsigned short          m_preloadedChannelsNb;
+    AVSampleFormat          m_preloadedSampleFormat;
+    unsigned short          m_preloadedSampleRate;
 
+    static const int        findAudioStream(AVFormatContext * fmt_ctx, FFmpegParameters * parameters);
+    const int               openStream(AVFormatContext * fmt_ctx, const int streamIndex, const size_t threadNb);
+    // Close demuxer and own IO context, if opening of the file fails after the demuxer is opened
+    void                    closeInput(AVFormatContext ** fmt_ctx);
+    // Read the next packet of this stream to \m_packet. Returns negative value as av_read_frame() does
+    const int               readPacket();
+    // True if [readRez] returned by readPacket() is caused by end of file
+    const bool              isEndOfFile(const int readRez) const;
+    void                    dispatchPacket(AVPacket & packet);
+    void                    clearPacketQueue();
     static const int        guessLayoutByChannelsNb(const int & chNb);
     static const int        calc_samples_get_buffer_size(const int & nb_samples, AVCodecContext * pCodecCtx);
     void                    release_params_getSample(void);
     const int               decodeAudio(int & buffer_size);
+    // Drop samples of decoded frame, which precede the seek target. Returns false if whole frame is dropped
+    const bool              trimDecodedFrame(double & pts, int & buffer_size);
     const bool              isAudioPlanar () const;
-    const int               dePlaneAudio (const int & nb_samples, AVCodecContext * pCodecCtx, uint8_t **src_data);
+    const int               getPreloadedSamples(unsigned short channelsNb,
+                                        const AVSampleFormat & output_sampleFormat,
+                                        unsigned short sample_rate,
+                                        unsigned long samplesNb,
+                                        unsigned char * bufSamples);
+    // In case of OSG_AUDIO_DIRECT_RESAMPLE decoded frame is left in \m_pFrame and \output_buffer is not used
     bool                    GetNextFrame(double & currTime, int16_t * output_buffer, unsigned int & output_buffer_size);
+#ifdef OSG_AUDIO_DIRECT_RESAMPLE
+    static const int        getSamplesDirect(FFmpegAudioReader* media,
+                                        unsigned short channelsNb,
+                                        const AVSampleFormat & output_sampleFormat,
+                                        unsigned short & sample_rate,
+                                        unsigned long & samplesNb,
+                                        unsigned char * bufSamples,
+                                        const double & max_avail_time_micros);
+#else
+    const int               dePlaneAudio (const int & nb_samples, AVCodecContext * pCodecCtx, uint8_t **src_data);
+#endif // OSG_AUDIO_DIRECT_RESAMPLE
 public:
     const int               openFile(const char *filename, FFmpegParameters * parameters);
+    // Open [audioStreamNb]-th audio stream of the file opened by [owner].
+    // Packets of both readers are demuxed in one pass. [owner] should be closed after this reader.
+    const int               openTrack(FFmpegAudioReader * owner, const int audioStreamNb);
+    // Number of audio streams of the opened file
+    const int               getAudioStreamNb(void) const;
     int                     seek(int64_t timestamp);
     void                    close(void);
 
@@ -104,6 +167,18 @@ public:
     const int               getFrameSize(void) const;
     // max value for using for seek
     const int64_t           get_duration(void) const;
+    // Relative number of output samples, which resampler adds(if positive) or removes(if negative)
+    void                    setCompensation(const double & compensation);
+    // Decode whole audio to output format, if it takes no more than [maxBytes].
+    // After that samples are served from memory and seeking does not touch the file.
+    const int               preload(unsigned short channelsNb,
+                                        const AVSampleFormat & output_sampleFormat,
+                                        unsigned short sample_rate,
+                                        const size_t & maxBytes);
+    // Read packets of this reader and its tracks ahead by I/O thread. Queue is limited by [maxBytes] and [maxDurationMS].
+    // Tracks should be opened before.
+    const int               prefetch(const size_t & maxBytes, const double & maxDurationMS);
+    const int               getPrefetchStats(FFmpegPacketPrefetcher::Stats & stats) const;
     static const int        getSamples(FFmpegAudioReader* media,
                                         unsigned long & msTime,
                                         unsigned short channelsNb,
@@ -26,15 +26,17 @@ namespace osgFFmpeg {
 
 
 
-FFmpegAudioStream::FFmpegAudioStream(FFmpegFileHolder * pFileHolder, FFmpegStreamer * pStreamer)
+FFmpegAudioStream::FFmpegAudioStream(FFmpegFileHolder * pFileHolder, FFmpegStreamer * pStreamer, const size_t trackNb)
 :m_pFileHolder(pFileHolder),
-m_streamer(pStreamer)
+m_streamer(pStreamer),
+m_trackNb(trackNb)
 {
 }
 
 
 FFmpegAudioStream::FFmpegAudioStream(const FFmpegAudioStream & audio, const osg::CopyOp & copyop) :
-    osg::AudioStream(audio, copyop)
+    osg::AudioStream(audio, copyop),
+    m_trackNb(0)
 {
 }
 
@@ -48,7 +50,16 @@ FFmpegAudioStream::~FFmpegAudioStream()
 void FFmpegAudioStream::setAudioSink(osg::AudioSink* audio_sink)
 {
     OSG_NOTICE<<"FFmpegAudioStream::setAudioSink( "<<audio_sink<<")"<<std::endl;
-    m_streamer->setAudioSink(audio_sink);
+    m_streamer->setAudioSink(m_trackNb, audio_sink);
+}
+
+
+const AudioFormat &
+FFmpegAudioStream::format() const
+{
+    if (m_trackNb > 0)
+        return m_pFileHolder->getExtraAudioFormat(m_trackNb - 1);
+    return m_pFileHolder->getAudioFormat();
 }
 
 
@@ -60,12 +71,12 @@ void FFmpegAudioStream::consumeAudioBuffer(void * const buffer, const size_t siz
     static double        playbackSec = -1.0;
     if (playbackSec < 0.0 && size > 0 && m_pFileHolder)
     {
-        const AudioFormat   audioFormat = m_pFileHolder->getAudioFormat();
+        const AudioFormat   audioFormat = format();
         playbackSec = (double)size / (double)(audioFormat.m_sampleRate * audioFormat.m_bytePerSample * audioFormat.m_channelsNb);
         av_log(NULL, AV_LOG_INFO, "Consumed audio chunk: %f sec", playbackSec);
     }
 
-    m_streamer->audio_fillBuffer(buffer, size);
+    m_streamer->audio_fillBuffer(m_trackNb, buffer, size);
 }
 
 double FFmpegAudioStream::duration() const
@@ -77,14 +88,14 @@ double FFmpegAudioStream::duration() const
 
 int FFmpegAudioStream::audioFrequency() const
 {
-    return m_pFileHolder->getAudioFormat().m_sampleRate;
+    return format().m_sampleRate;
 }
 
 
 
 int FFmpegAudioStream::audioNbChannels() const
 {
-    return m_pFileHolder->getAudioFormat().m_channelsNb;
+    return format().m_channelsNb;
 }
 
 
@@ -103,7 +114,7 @@ FFmpegAudioStream::audioSampleFormat() const
     // So, even if some file contains audio with 24-bit samples,
     // ffmpeg converts it to available AV_SAMPLE_FMT_S32 automatically
     //
-    switch (m_pFileHolder->getAudioFormat().m_avSampleFormat)
+    switch (format().m_avSampleFormat)
     {
     case AV_SAMPLE_FMT_U8:
         result = osg::AudioStream::SAMPLE_FORMAT_U8;
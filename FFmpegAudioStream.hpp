@@ -24,13 +24,16 @@ namespace osgFFmpeg
 {
     class FFmpegFileHolder;
     class FFmpegStreamer;
+    struct AudioFormat;
 
     class FFmpegAudioStream : public osg::AudioStream
     {
     public:
 
+                                        // [trackNb] ZERO is the main audio track, others are extra tracks
                                         FFmpegAudioStream (FFmpegFileHolder * pFileHolder = NULL,
-                                                        FFmpegStreamer * pStreamer = NULL);
+                                                        FFmpegStreamer * pStreamer = NULL,
+                                                        const size_t trackNb = 0);
 
                                         FFmpegAudioStream(const FFmpegAudioStream & audio,
                                                         const osg::CopyOp & copyop = osg::CopyOp::SHALLOW_COPY);
@@ -52,8 +55,11 @@ namespace osgFFmpeg
 
         virtual                         ~FFmpegAudioStream();
 
+        const AudioFormat &             format() const;
+
         FFmpegFileHolder *              m_pFileHolder;
         FFmpegStreamer *                m_streamer;
+        size_t                          m_trackNb;
 
     };
 
@@ -0,0 +1,179 @@
+/* Improved ffmpeg plugin for OpenSceneGraph -
+ * Copyright (C) 2014-2015 Digitalis Education Solutions, Inc. (http://DigitalisEducation.com)
+ * File author: Oktay Radzhabov (oradzhabov at jazzros dot com)
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+#include "FFmpegBlockCache.hpp"
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+
+namespace osgFFmpeg
+{
+
+namespace
+{
+// Unit of reading from the source
+const int       BlockSize       = 256 * 1024;
+// Cache holds at least blocks of audio and video readers and their neighbours
+const size_t    MinBlockNb      = 4;
+}
+
+FFmpegBlockCache::Mutex     FFmpegBlockCache::s_mutex;
+FFmpegBlockCache::CacheMap  FFmpegBlockCache::s_caches;
+
+FFmpegBlockCache::FFmpegBlockCache(AVIOContext * source, const int64_t & size, const size_t & maxBytes)
+:m_source(source),
+m_maxBlocks(std::max(MinBlockNb, maxBytes / BlockSize)),
+m_useCounter(0)
+{
+    m_size = size;
+}
+
+FFmpegBlockCache::~FFmpegBlockCache()
+{
+    avio_close(m_source);
+}
+
+osg::ref_ptr<FFmpegBlockCache>
+FFmpegBlockCache::acquire(const std::string & url, const size_t & maxBytes, AVDictionary * options)
+{
+    ScopedLock                      lock (s_mutex);
+    osg::ref_ptr<FFmpegBlockCache>  cache;
+    //
+    // Cache, which is released by the last reader, could not be locked
+    //
+    CacheMap::iterator              it = s_caches.find(url);
+    if (it != s_caches.end() && it->second.lock(cache))
+        return cache;
+    //
+    // Options are consumed by opening, so the source gets own copy of them
+    //
+    AVDictionary *                  sourceOptions = NULL;
+    AVIOContext *                   source = NULL;
+
+    av_dict_copy(& sourceOptions, options, 0);
+    const int                       error = avio_open2(& source, url.c_str(), AVIO_FLAG_READ, NULL, & sourceOptions);
+    av_dict_free(& sourceOptions);
+
+    if (error < 0)
+    {
+        av_log(NULL, AV_LOG_WARNING, "Cannot open %s for caching", url.c_str());
+        return cache;
+    }
+    //
+    // Live streams are read by each reader separately
+    //
+    const int64_t                   size = avio_size(source);
+    if (size <= 0 || source->seekable == 0)
+    {
+        av_log(NULL, AV_LOG_INFO, "Source %s is not cached, because it is not seekable", url.c_str());
+        avio_close(source);
+        return cache;
+    }
+
+    cache = new FFmpegBlockCache(source, size, maxBytes);
+    s_caches[url] = cache.get();
+
+    return cache;
+}
+
+int
+FFmpegBlockCache::copyCached(const int64_t & index, const int offset, uint8_t * buf, const int bytesNb)
+{
+    BlockMap::iterator  it = m_blocks.find(index);
+    if (it == m_blocks.end())
+        return -1;
+
+    Block &             block = it->second;
+    const int           copyNb = std::min(bytesNb, (int)block.Data.size() - offset);
+    if (copyNb <= 0)
+        return AVERROR_EOF;
+
+    memcpy(buf, & block.Data[offset], copyNb);
+    block.LastUse = ++m_useCounter;
+
+    return copyNb;
+}
+
+int
+FFmpegBlockCache::readAt(Reader & reader, uint8_t * buf, const int bytesNb)
+{
+    const int64_t       index = reader.Pos / BlockSize;
+    const int           offset = (int)(reader.Pos % BlockSize);
+    const int           copyNb = std::min(bytesNb, BlockSize - offset);
+    {
+        ScopedLock      lock (m_mutex);
+
+        const int       result = copyCached(index, offset, buf, copyNb);
+        if (result >= 0 || result == AVERROR_EOF)
+            return result;
+    }
+    //
+    // Block is read once, while other readers of the same block wait for it
+    //
+    ScopedLock          ioLock (m_ioMutex);
+    {
+        ScopedLock      lock (m_mutex);
+
+        const int       result = copyCached(index, offset, buf, copyNb);
+        if (result >= 0 || result == AVERROR_EOF)
+            return result;
+    }
+    const int64_t       start = index * BlockSize;
+    Block               block;
+
+    block.Data.resize((size_t)std::min<int64_t>(BlockSize, m_size - start));
+
+    if (avio_seek(m_source, start, SEEK_SET) < 0)
+        return AVERROR(EIO);
+
+    size_t              readNb = 0;
+    while (readNb < block.Data.size())
+    {
+        const int       result = avio_read(m_source, & block.Data[readNb], (int)(block.Data.size() - readNb));
+        if (result <= 0)
+            break;
+        readNb += result;
+    }
+    if (readNb == 0)
+        return AVERROR(EIO);
+    // Source could be shorter than its reported size
+    block.Data.resize(readNb);
+
+    ScopedLock          lock (m_mutex);
+
+    m_blocks[index].Data.swap(block.Data);
+    const int           result = copyCached(index, offset, buf, copyNb);
+    evict();
+
+    return result;
+}
+
+void
+FFmpegBlockCache::evict()
+{
+    while (m_blocks.size() > m_maxBlocks)
+    {
+        BlockMap::iterator  oldest = m_blocks.begin();
+        for (BlockMap::iterator it = m_blocks.begin(); it != m_blocks.end(); ++it)
+        {
+            if (it->second.LastUse < oldest->second.LastUse)
+                oldest = it;
+        }
+        m_blocks.erase(oldest);
+    }
+}
+
+} // namespace osgFFmpeg
@@ -0,0 +1,79 @@
+/* Improved ffmpeg plugin for OpenSceneGraph -
+ * Copyright (C) 2014-2015 Digitalis Education Solutions, Inc. (http://DigitalisEducation.com)
+ * File author: Oktay Radzhabov (oradzhabov at jazzros dot com)
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+#ifndef HEADER_GUARD_FFMPEG_BLOCKCACHE_H
+#define HEADER_GUARD_FFMPEG_BLOCKCACHE_H
+
+#include "FFmpegMemorySource.hpp"
+#include <osg/observer_ptr>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace osgFFmpeg {
+
+//
+// Process-wide cache of blocks of the file, keyed by URL. Each reader of the file(audio and
+// video readers of the player, other players of the same asset) gets own IO context, which
+// reads through the cache, so the file is read from disk or network once while its blocks are cached.
+//
+// Cache is released with the last IO context. Only sources with known size and seeking are cached.
+//
+class FFmpegBlockCache : public FFmpegMemorySource
+{
+public:
+    // Cache of [url]. Capacity [maxBytes] is used if the cache is created by this call.
+    // [options] are used for opening of the source. Returns NULL if source could not be cached
+    static osg::ref_ptr<FFmpegBlockCache>   acquire(const std::string & url, const size_t & maxBytes, AVDictionary * options);
+
+protected:
+                                    FFmpegBlockCache(AVIOContext * source, const int64_t & size, const size_t & maxBytes);
+    virtual                         ~FFmpegBlockCache();
+    virtual int                     readAt(Reader & reader, uint8_t * buf, const int bytesNb);
+
+private:
+    typedef OpenThreads::Mutex              Mutex;
+    typedef OpenThreads::ScopedLock<Mutex>  ScopedLock;
+    typedef std::map<std::string, osg::observer_ptr<FFmpegBlockCache> >  CacheMap;
+
+    struct Block
+    {
+        std::vector<unsigned char>  Data;
+        unsigned long               LastUse;
+    };
+    typedef std::map<int64_t, Block>        BlockMap;
+
+    // Copies bytes of cached block [index]. Returns -1 if the block is not cached
+    int                             copyCached(const int64_t & index, const int offset, uint8_t * buf, const int bytesNb);
+    // Least recently used blocks are removed to keep cache in its capacity. Should be called with locked \m_mutex
+    void                            evict();
+
+    static Mutex                    s_mutex;
+    static CacheMap                 s_caches;
+
+    Mutex                           m_ioMutex;      // source is read by one reader at once
+    AVIOContext *                   m_source;
+    Mutex                           m_mutex;        // guards blocks
+    BlockMap                        m_blocks;
+    size_t                          m_maxBlocks;
+    unsigned long                   m_useCounter;
+};
+
+} // namespace osgFFmpeg
+
+#endif // HEADER_GUARD_FFMPEG_BLOCKCACHE_H
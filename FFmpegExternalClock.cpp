@@ -0,0 +1,47 @@
+/* Improved ffmpeg plugin for OpenSceneGraph -
+ * Copyright (C) 2014-2015 Digitalis Education Solutions, Inc. (http://DigitalisEducation.com)
+ * File author: Oktay Radzhabov (oradzhabov at jazzros dot com)
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+#include "FFmpegExternalClock.hpp"
+
+namespace osgFFmpeg
+{
+
+FFmpegExternalClock::FFmpegExternalClock()
+:m_timeMS(0)
+{
+}
+
+FFmpegExternalClock::~FFmpegExternalClock()
+{
+}
+
+void
+FFmpegExternalClock::setClockTime(const unsigned long & timeMS)
+{
+    ScopedLock  lock (m_mutex);
+
+    m_timeMS = timeMS;
+}
+
+const unsigned long
+FFmpegExternalClock::GetClockTime() const
+{
+    ScopedLock  lock (m_mutex);
+
+    return m_timeMS;
+}
+
+} // namespace osgFFmpeg
@@ -0,0 +1,51 @@
+/* Improved ffmpeg plugin for OpenSceneGraph -
+ * Copyright (C) 2014-2015 Digitalis Education Solutions, Inc. (http://DigitalisEducation.com)
+ * File author: Oktay Radzhabov (oradzhabov at jazzros dot com)
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+#ifndef HEADER_GUARD_FFMPEG_EXTERNALCLOCK_H
+#define HEADER_GUARD_FFMPEG_EXTERNALCLOCK_H
+
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
+#include "FFmpegIClock.hpp"
+
+namespace osgFFmpeg {
+
+//
+// Clock, which time is set by the application, e.g. simulation time of the rendered frame.
+// It does not run by itself, so the player shows the frame of the last given time.
+//
+class FFmpegExternalClock : public FFmpegIClock
+{
+public:
+                                    FFmpegExternalClock();
+
+    void                            setClockTime(const unsigned long & timeMS);
+    virtual const unsigned long     GetClockTime() const;
+
+protected:
+    virtual                         ~FFmpegExternalClock();
+
+private:
+    typedef OpenThreads::Mutex              Mutex;
+    typedef OpenThreads::ScopedLock<Mutex>  ScopedLock;
+
+    mutable Mutex                   m_mutex;
+    unsigned long                   m_timeMS;
+};
+
+} // namespace osgFFmpeg
+
+#endif // HEADER_GUARD_FFMPEG_EXTERNALCLOCK_H
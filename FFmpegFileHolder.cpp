@@ -16,6 +16,9 @@
 
 #include "FFmpegFileHolder.hpp"
 #include "FFmpegWrapper.hpp"
+#include "FFmpegParameters.hpp"
+#include <osgDB/FileNameUtils>
+#include <sstream>
 
 namespace osgFFmpeg {
 
@@ -23,7 +26,9 @@ FFmpegFileHolder::FFmpegFileHolder()
 :m_audioIndex(-1),m_videoIndex(-1),
 m_duration(0),
 m_pixAspectRatio(1.0f),
-m_alpha_channel(false)
+m_alpha_channel(false),
+m_audioOnly(false),
+m_offline(false)
 {
 }
 
@@ -87,6 +92,36 @@ FFmpegFileHolder::getAudioFormat() const
     return m_audioFormat;
 }
 
+const size_t
+FFmpegFileHolder::extraAudioNb() const
+{
+    return m_extraAudioIndices.size();
+}
+
+const long
+FFmpegFileHolder::extraAudioIndex(const size_t trackNb) const
+{
+    return m_extraAudioIndices[trackNb];
+}
+
+const AudioFormat &
+FFmpegFileHolder::getExtraAudioFormat(const size_t trackNb) const
+{
+    return m_extraAudioFormats[trackNb];
+}
+
+const bool
+FFmpegFileHolder::isAudioOnly() const
+{
+    return m_audioOnly;
+}
+
+const bool
+FFmpegFileHolder::isOffline() const
+{
+    return m_offline;
+}
+
 const AVPixelFormat
 FFmpegFileHolder::getPixFormat() const
 {
@@ -137,43 +172,38 @@ FFmpegFileHolder::open (const std::string & filename, FFmpegParameters* paramete
 {
     if (m_audioIndex < 0 && m_videoIndex < 0)
     {
+        m_audioOnly = detectAudioOnly(filename, parameters);
+        m_offline = detectOffline(parameters);
         //
         // Open For Audio
         //
         m_audioIndex = FFmpegWrapper::openAudio(filename.c_str(), parameters);
         if (m_audioIndex >= 0)
         {
-            unsigned long audioInfo[4];
-            FFmpegWrapper::getAudioInfo(m_audioIndex, audioInfo);
-            //
-            //
-            //
-            m_audioFormat.m_bytePerSample   = audioInfo[0];
-            m_audioFormat.m_channelsNb      = audioInfo[1];
-            m_audioFormat.m_sampleRate      = audioInfo[2];
-            m_audioFormat.m_avSampleFormat  = (AVSampleFormat)audioInfo[3];
-            //
-            // Because SDL available for: AUDIO_U16SYS,AUDIO_S16SYS,AUDIO_S32SYS,AUDIO_F32SYS only (see "SDL_audio.h")
-            // we can use limited set of output sample format only.
-            // Moreover, base test-app (Example osgmovie) use "AUDIO_S16SYS" hardcoded, so
-            // let it be follow:
-            //
-            m_audioFormat.m_bytePerSample   = 2;
-            m_audioFormat.m_avSampleFormat  = AV_SAMPLE_FMT_S16;
+            readAudioFormat(m_audioIndex, parameters, m_audioFormat);
+
+            openExtraAudio(parameters);
+        }
+        else
+        {
+            m_audioOnly = false;
         }
         //
-        // Open For Video
+        // Open For Video. Audio-only file skips second opening and probing of the file
         //
         m_frameSize.Width                   = 640;  // default
         m_frameSize.Height                  = 480;  // values
         m_alpha_channel                     = false;
 
-        m_videoIndex = FFmpegWrapper::openVideo(filename.c_str(),
-                                                parameters,
-                                                m_pixFmt,
-                                                m_pixAspectRatio,
-                                                m_frame_rate,
-                                                m_alpha_channel);
+        if (m_audioOnly == false)
+        {
+            m_videoIndex = FFmpegWrapper::openVideo(filename.c_str(),
+                                                    parameters,
+                                                    m_pixFmt,
+                                                    m_pixAspectRatio,
+                                                    m_frame_rate,
+                                                    m_alpha_channel);
+        }
         //
         // Prepare General parameters
         //
@@ -209,6 +239,11 @@ FFmpegFileHolder::open (const std::string & filename, FFmpegParameters* paramete
                 m_frameSize.Width = imgSize[0];
                 m_frameSize.Height = imgSize[1];
             }
+            //
+            // Short clips are served from memory, network sources are read ahead
+            //
+            preload(parameters);
+            prefetch(filename, parameters);
 
             return 0; // NoError
         }
@@ -221,9 +256,251 @@ FFmpegFileHolder::open (const std::string & filename, FFmpegParameters* paramete
     return -1;
 }
 
+const AVSampleFormat
+FFmpegFileHolder::getOutputSampleFormat(const AVSampleFormat decoderFmt, FFmpegParameters* parameters)
+{
+    AVDictionaryEntry *     dictEntry = NULL;
+    if (parameters)
+        dictEntry = av_dict_get(* parameters->getOptions(), "audio_sample_format", NULL, 0);
+
+    if (dictEntry == NULL)
+        return AV_SAMPLE_FMT_S16;
+
+    const std::string       value(dictEntry->value);
+
+    if (value == "u8")
+        return AV_SAMPLE_FMT_U8;
+    if (value == "s16")
+        return AV_SAMPLE_FMT_S16;
+    if (value == "s32")
+        return AV_SAMPLE_FMT_S32;
+    if (value == "flt" || value == "f32")
+        return AV_SAMPLE_FMT_FLT;
+    if (value == "auto")
+    {
+        //
+        // Keep format of decoder if it could be reported by osg::AudioStream,
+        // so resampler has not to convert samples. Most of modern codecs (AAC, Vorbis, Opus) decode to float.
+        //
+        switch (decoderFmt)
+        {
+        case AV_SAMPLE_FMT_U8:
+        case AV_SAMPLE_FMT_S16:
+        case AV_SAMPLE_FMT_S32:
+        case AV_SAMPLE_FMT_FLT:
+            return decoderFmt;
+        default:
+            return AV_SAMPLE_FMT_FLT;
+        };
+    }
+
+    av_log(NULL, AV_LOG_WARNING, "Unknown audio sample format %s, s16 is used", value.c_str());
+
+    return AV_SAMPLE_FMT_S16;
+}
+
+void
+FFmpegFileHolder::readAudioFormat(const long audioIndex, FFmpegParameters* parameters, AudioFormat & audioFormat)
+{
+    unsigned long audioInfo[4];
+    FFmpegWrapper::getAudioInfo(audioIndex, audioInfo);
+    //
+    //
+    //
+    audioFormat.m_bytePerSample     = audioInfo[0];
+    audioFormat.m_channelsNb        = audioInfo[1];
+    audioFormat.m_sampleRate        = audioInfo[2];
+    audioFormat.m_avSampleFormat    = (AVSampleFormat)audioInfo[3];
+    //
+    // Because SDL available for: AUDIO_U16SYS,AUDIO_S16SYS,AUDIO_S32SYS,AUDIO_F32SYS only (see "SDL_audio.h")
+    // we can use limited set of output sample format only.
+    // Moreover, base test-app (Example osgmovie) use "AUDIO_S16SYS" hardcoded, so
+    // S16 is used by default. Sink, which reads osg::AudioStream::audioSampleFormat(),
+    // could ask another format by option "audio_sample_format".
+    //
+    audioFormat.m_avSampleFormat    = getOutputSampleFormat(audioFormat.m_avSampleFormat, parameters);
+    audioFormat.m_bytePerSample     = av_get_bytes_per_sample(audioFormat.m_avSampleFormat);
+}
+
+const bool
+FFmpegFileHolder::detectAudioOnly(const std::string & filename, FFmpegParameters* parameters)
+{
+    AVDictionaryEntry *     dictEntry = NULL;
+    if (parameters)
+        dictEntry = av_dict_get(* parameters->getOptions(), "audio_only", NULL, 0);
+
+    if (dictEntry != NULL)
+    {
+        const std::string   value(dictEntry->value);
+
+        return (value == "1" || value == "yes" || value == "true");
+    }
+    //
+    // Extensions, which could not contain video. Note: "ogg" is not here, because it could be Theora movie
+    //
+    const std::string       ext = osgDB::getLowerCaseFileExtension(filename);
+
+    return (ext == "wav" || ext == "aiff" || ext == "mp2");
+}
+
+const bool
+FFmpegFileHolder::detectOffline(FFmpegParameters* parameters)
+{
+    AVDictionaryEntry *     dictEntry = NULL;
+    if (parameters)
+        dictEntry = av_dict_get(* parameters->getOptions(), "offline", NULL, 0);
+
+    if (dictEntry == NULL)
+        return false;
+
+    const std::string       value(dictEntry->value);
+
+    return (value == "1" || value == "yes" || value == "true");
+}
+
+void
+FFmpegFileHolder::preload(FFmpegParameters* parameters)
+{
+    AVDictionaryEntry *     durationEntry = NULL;
+    AVDictionaryEntry *     sizeEntry = NULL;
+    if (parameters)
+    {
+        durationEntry = av_dict_get(* parameters->getOptions(), "preload_duration", NULL, 0);
+        sizeEntry = av_dict_get(* parameters->getOptions(), "preload_size", NULL, 0);
+    }
+    if (durationEntry == NULL && sizeEntry == NULL)
+        return;
+
+    if (durationEntry != NULL && m_duration > (unsigned long)atol(durationEntry->value))
+        return;
+    //
+    // Memory budget of one clip. Decoded audio takes it first, video packets take the rest.
+    //
+    const double            defaultBudgetMB = 32.0;
+    size_t                  budget = (size_t)((sizeEntry != NULL ? atof(sizeEntry->value) : defaultBudgetMB) * 1024.0 * 1024.0);
+
+    if (m_audioIndex >= 0 && m_extraAudioIndices.empty())
+    {
+        const size_t        pcmBytes = (size_t)((double)m_duration / 1000.0 *
+                                                m_audioFormat.m_sampleRate *
+                                                m_audioFormat.m_channelsNb *
+                                                m_audioFormat.m_bytePerSample);
+
+        if (pcmBytes <= budget &&
+            FFmpegWrapper::preloadAudio(m_audioIndex,
+                                        m_audioFormat.m_channelsNb,
+                                        m_audioFormat.m_avSampleFormat,
+                                        m_audioFormat.m_sampleRate,
+                                        budget) == 0)
+        {
+            budget -= pcmBytes;
+        }
+    }
+    if (m_videoIndex >= 0 && budget > 0)
+        FFmpegWrapper::preloadVideo(m_videoIndex, budget);
+}
+
+void
+FFmpegFileHolder::prefetch(const std::string & filename, FFmpegParameters* parameters)
+{
+    AVDictionaryEntry *     durationEntry = NULL;
+    AVDictionaryEntry *     sizeEntry = NULL;
+    if (parameters)
+    {
+        durationEntry = av_dict_get(* parameters->getOptions(), "prefetch_duration", NULL, 0);
+        sizeEntry = av_dict_get(* parameters->getOptions(), "prefetch_size", NULL, 0);
+    }
+    //
+    // Local files are read ahead only by request
+    //
+    if (durationEntry == NULL && sizeEntry == NULL && osgDB::containsServerAddress(filename) == false)
+        return;
+
+    const double            defaultDurationMS = 5000.0;
+    const double            defaultSizeMB = 16.0;
+    const double            durationMS = (durationEntry != NULL) ? atof(durationEntry->value) : defaultDurationMS;
+    const size_t            maxBytes = (size_t)((sizeEntry != NULL ? atof(sizeEntry->value) : defaultSizeMB) * 1024.0 * 1024.0);
+
+    if (durationMS <= 0.0 || maxBytes == 0)
+        return;
+    //
+    // Audio and video are read by own demuxers, so each of them gets the whole budget
+    //
+    if (m_audioIndex >= 0)
+        FFmpegWrapper::prefetchAudio(m_audioIndex, maxBytes, durationMS);
+    if (m_videoIndex >= 0)
+        FFmpegWrapper::prefetchVideo(m_videoIndex, maxBytes, durationMS);
+}
+
+void
+FFmpegFileHolder::getPrefetchStats(FFmpegPacketPrefetcher::Stats & videoStats, FFmpegPacketPrefetcher::Stats & audioStats) const
+{
+    videoStats = FFmpegPacketPrefetcher::Stats();
+    audioStats = FFmpegPacketPrefetcher::Stats();
+
+    if (m_videoIndex >= 0)
+        FFmpegWrapper::getVideoPrefetchStats(m_videoIndex, videoStats);
+    if (m_audioIndex >= 0)
+        FFmpegWrapper::getAudioPrefetchStats(m_audioIndex, audioStats);
+}
+
+void
+FFmpegFileHolder::openExtraAudio(FFmpegParameters* parameters)
+{
+    AVDictionaryEntry *     dictEntry = NULL;
+    if (parameters)
+        dictEntry = av_dict_get(* parameters->getOptions(), "audio_tracks", NULL, 0);
+
+    if (dictEntry == NULL)
+        return;
+    //
+    // "all" or comma separated numbers of audio streams
+    //
+    std::vector<int>        tracks;
+    const std::string       value(dictEntry->value);
+    if (value == "all")
+    {
+        const int   audioStreamNb = FFmpegWrapper::getAudioStreamNb(m_audioIndex);
+        for (int i = 0; i < audioStreamNb; ++i)
+            tracks.push_back(i);
+    }
+    else
+    {
+        std::istringstream  stream(value);
+        std::string         item;
+        while (std::getline(stream, item, ','))
+        {
+            if (item.empty() == false)
+                tracks.push_back(atoi(item.c_str()));
+        }
+    }
+
+    for (size_t i = 0; i < tracks.size(); ++i)
+    {
+        // Main track and wrong numbers are skipped
+        const long  trackIndex = FFmpegWrapper::openAudioTrack(m_audioIndex, tracks[i]);
+        if (trackIndex < 0)
+            continue;
+
+        AudioFormat audioFormat;
+        readAudioFormat(trackIndex, parameters, audioFormat);
+
+        m_extraAudioIndices.push_back(trackIndex);
+        m_extraAudioFormats.push_back(audioFormat);
+    }
+}
+
 void
 FFmpegFileHolder::close ()
 {
+    //
+    // Tracks use demuxer of the main audio, so they are closed first
+    //
+    for (size_t i = 0; i < m_extraAudioIndices.size(); ++i)
+        FFmpegWrapper::closeAudio(m_extraAudioIndices[i]);
+    m_extraAudioIndices.clear();
+    m_extraAudioFormats.clear();
+
     if (m_audioIndex >= 0)
     {
         FFmpegWrapper::closeAudio(m_audioIndex);
@@ -234,6 +511,8 @@ FFmpegFileHolder::close ()
         FFmpegWrapper::closeVideo(m_videoIndex);
         m_videoIndex = -1;
     }
+    m_audioOnly = false;
+    m_offline = false;
 }
 
 
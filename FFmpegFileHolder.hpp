@@ -18,8 +18,10 @@
 #define HEADER_GUARD_FFMPEG_FILEHOLDER_H
 
 #include "FFmpegHeaders.hpp"
+#include "FFmpegPacketPrefetcher.hpp"
 #include <osg/ImageStream>
 #include <string>
+#include <vector>
 
 namespace osgFFmpeg {
 
@@ -56,16 +58,34 @@ class FFmpegFileHolder
     unsigned long           m_duration; // ms
     //
     AudioFormat             m_audioFormat;
+    std::vector<long>       m_extraAudioIndices;
+    std::vector<AudioFormat>    m_extraAudioFormats;
     //
     Size                    m_frameSize;
     AVPixelFormat           m_pixFmt;
     float                   m_pixAspectRatio;
     float                   m_frame_rate;
     bool                    m_alpha_channel;
+    bool                    m_audioOnly;
+    bool                    m_offline;
 
 
                             FFmpegFileHolder(const FFmpegFileHolder &) {} // Avoid copy-constructor
 
+    // Output sample format by option "audio_sample_format" and sample format of decoder
+    static const AVSampleFormat getOutputSampleFormat(const AVSampleFormat decoderFmt, FFmpegParameters* parameters);
+    static void             readAudioFormat(const long audioIndex, FFmpegParameters* parameters, AudioFormat & audioFormat);
+    // Open audio tracks, listed by option "audio_tracks"
+    void                    openExtraAudio(FFmpegParameters* parameters);
+    // Audio-only files are not probed for video. Option "audio_only" overrides detection by extension
+    static const bool       detectAudioOnly(const std::string & filename, FFmpegParameters* parameters);
+    // Offline rendering is requested by option "offline"
+    static const bool       detectOffline(FFmpegParameters* parameters);
+    // Keep short clip in memory by options "preload_duration" and "preload_size"
+    void                    preload(FFmpegParameters* parameters);
+    // Read network source ahead by options "prefetch_duration" and "prefetch_size"
+    void                    prefetch(const std::string & filename, FFmpegParameters* parameters);
+
 public:
                             FFmpegFileHolder();
     const short             open (const std::string & filename, FFmpegParameters* parameters);
@@ -85,6 +105,16 @@ public:
     const long              audioIndex() const;
     const bool              isHasAudio() const;
     const AudioFormat &     getAudioFormat() const;
+    // Additional audio tracks, decoded together with the main one
+    const size_t            extraAudioNb() const;
+    const long              extraAudioIndex(const size_t trackNb) const;
+    const AudioFormat &     getExtraAudioFormat(const size_t trackNb) const;
+    // File is opened without video machinery
+    const bool              isAudioOnly() const;
+    // Every frame is rendered in order by time of the application, without real-time pacing and audio
+    const bool              isOffline() const;
+    // Queues of the packets read ahead. Not prefetched stream reports empty queue
+    void                    getPrefetchStats(FFmpegPacketPrefetcher::Stats & videoStats, FFmpegPacketPrefetcher::Stats & audioStats) const;
 };
 
 } // namespace osgFFmpeg
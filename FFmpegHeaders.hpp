@@ -46,6 +46,7 @@ extern "C"
 #include <libavutil/mathematics.h>
 #include <libavutil/parseutils.h>
 #include <libavutil/pixdesc.h>
+#include <libavutil/avstring.h>
 
 #ifdef USE_SWSCALE
     #include <libswscale/swscale.h>
@@ -103,6 +104,24 @@ extern "C"
 //ENDIF()
 #ifdef USE_SWRESAMPLE
     #include <libswresample/swresample.h>
+    #include <libavutil/opt.h>
+#endif
+//
+// Planes of decoded audio frame are passed to swr_convert() as is. Resampler makes
+// planar-to-interleaved conversion itself, so decoded data is not copied
+// to intermediate buffers. Output never exceeds required number of samples,
+// so it could be written directly to the audio ring-buffer.
+//
+#if defined(USE_SWRESAMPLE) && LIBAVCODEC_VERSION_MAJOR >= 54
+    #define OSG_AUDIO_DIRECT_RESAMPLE
+#endif
+//
+// Packets are sent to decoder and frames are received from it independently.
+// Frame-threaded decoder keeps several frames in flight, and timestamps are taken
+// from best_effort_timestamp of decoded frame, so B-frames get their presentation time.
+//
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(57, 37, 100)
+    #define OSG_SEND_RECEIVE_DECODE
 #endif
 
 // Changes for FFMpeg version greater than 0.6
@@ -142,6 +161,27 @@ extern "C"
     #endif
 #endif
 
+// av_frame_clone() copies data of the frames which are not reference-counted,
+// so it could be used to keep decoded frames of the old decoding API
+#if LIBAVCODEC_VERSION_MAJOR >= 55
+    #define OSG_CLONE_FRAME     av_frame_clone
+#endif
+
+// av_packet_ref() shares data of reference-counted packet, so it is not copied
+#if LIBAVCODEC_VERSION_MAJOR >= 56
+    #define OSG_REF_PACKET      av_packet_ref
+#endif
+
+// Interrupt callback of demuxer is copied to I/O context opened by it, so blocking read could be aborted
+#if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(53, 15, 0)
+    #define OSG_INTERRUPT_CALLBACK
+#endif
+
+// AVFrame::best_effort_timestamp exists in FFmpeg only (micro version >= 100), Libav lacks it
+#if LIBAVCODEC_VERSION_MAJOR >= 54 && LIBAVCODEC_VERSION_MICRO >= 100
+    #define OSG_BEST_EFFORT_TIMESTAMP
+#endif
+
 }
 
 
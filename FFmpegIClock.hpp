@@ -0,0 +1,40 @@
+/* Improved ffmpeg plugin for OpenSceneGraph -
+ * Copyright (C) 2014-2015 Digitalis Education Solutions, Inc. (http://DigitalisEducation.com)
+ * File author: Oktay Radzhabov (oradzhabov at jazzros dot com)
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+#ifndef HEADER_GUARD_FFMPEG_ICLOCK_H
+#define HEADER_GUARD_FFMPEG_ICLOCK_H
+
+#include <osg/Referenced>
+
+namespace osgFFmpeg {
+
+//
+// Source of the presentation time. By default player is driven by own timer or by played audio.
+// Player with attached clock selects its frames by the time of the clock.
+//
+class FFmpegIClock : public osg::Referenced
+{
+public:
+    // Return time of the clock in ms. It is not wrapped by looping, same as the playback clock of the player
+    virtual const unsigned long     GetClockTime() const = 0;
+
+protected:
+    virtual                         ~FFmpegIClock() {};
+};
+
+} // namespace osgFFmpeg
+
+#endif // HEADER_GUARD_FFMPEG_ICLOCK_H
@@ -17,6 +17,8 @@
 #ifndef HEADER_GUARD_FFMPEG_ILIBAVSTREAMIMPL_H
 #define HEADER_GUARD_FFMPEG_ILIBAVSTREAMIMPL_H
 
+#include <cstddef>
+
 namespace osg {
 
     class AudioSink;
@@ -26,6 +28,7 @@ namespace osgFFmpeg {
 
 class FFmpegPlayer;
 class FFmpegFileHolder;
+class FFmpegIClock;
 
 class FFmpegILibAvStreamImpl
 {
@@ -33,6 +36,8 @@ public:
     virtual                         ~FFmpegILibAvStreamImpl() {};
 
     virtual void                    setAudioSink(osg::AudioSink * audio_sink) = 0;
+    // Sink of extra audio track. [trackNb] is ZERO-based number of extra track
+    virtual void                    setExtraAudioSink(const size_t trackNb, osg::AudioSink * audio_sink) = 0;
     virtual void                    setAudioDelayMicroSec (const double & audioDelayMicroSec) = 0;
     virtual const int               initialize(const FFmpegFileHolder * pHolder, FFmpegPlayer * pPlayer) = 0;
     virtual void                    loop(const bool loop) = 0;
@@ -40,9 +45,18 @@ public:
 
 
     virtual void                    Start() = 0;
+    // Fill buffers from the current position, but do not start playback. Next Start() plays buffered data
+    virtual void                    Prefill() = 0;
     virtual void                    Pause() = 0;
     virtual void                    Stop() = 0;
     virtual void                    Seek(const unsigned long & newTimeMS) = 0;
+    // Playback rate: 1.0 is normal speed, negative value means reverse direction
+    virtual void                    setPlaybackRate(const double & rate) = 0;
+    virtual const double            getPlaybackRate() const = 0;
+    // Pause playback and move exactly one frame forward(direction > 0) or backward(direction < 0)
+    virtual const int               Step(const int direction) = 0;
+    // Hint for memory manager: invisible video gives frame memory to visible ones
+    virtual void                    setVisible(const bool visible) = 0;
 
     virtual const bool              isHasAudio() const = 0;
     virtual void                    setAudioVolume(const float &) = 0;
@@ -51,8 +65,13 @@ public:
     virtual const float             getAudioBalance() const = 0;
     virtual void                    setAudioBalance(const float & balance) = 0;
     virtual void                    GetAudio(void * buffer, int bytesLength) = 0;
+    virtual void                    GetExtraAudio(const size_t trackNb, void * buffer, int bytesLength) = 0;
     // Return playback time in ms
     virtual const unsigned long     GetPlaybackTime() const = 0;
+    // Return time of the playback clock in ms. It is not wrapped by looping, and frames are requested by this time
+    virtual const unsigned long     GetClockTime() const = 0;
+    // Playback clock follows external [clock] instead of own timer or audio. NULL restores own clock
+    virtual void                    setClock(FFmpegIClock * clock) = 0;
     //
     /*
      * DO NOT FORGET CALL ReleaseFoundFrame() AFTER GetFramePtr() CALLED AND PTR HAS BEEN USED.
@@ -60,6 +79,8 @@ public:
      */
     virtual int                     GetFramePtr(const unsigned long & timePosMS, unsigned char *& pArray) = 0;
     virtual void                    ReleaseFoundFrame() = 0;
+    // Offline rendering: wait till the frame of [timePosMS] is decoded, and publish it in caller's thread
+    virtual const int               RenderFrame(const unsigned long & timePosMS) = 0;
     virtual const bool              isHasVideo() const = 0;
     virtual float                   fps() const = 0;
 };
@@ -0,0 +1,288 @@
+/* Improved ffmpeg plugin for OpenSceneGraph -
+ * Copyright (C) 2014-2015 Digitalis Education Solutions, Inc. (http://DigitalisEducation.com)
+ * File author: Oktay Radzhabov (oradzhabov at jazzros dot com)
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+#include "FFmpegImageView.hpp"
+
+#include <osg/Notify>
+#include <osg/NodeVisitor>
+#include <osg/FrameStamp>
+
+namespace osgFFmpeg {
+
+FFmpegImageView::Mutex      FFmpegImageView::s_mutex;
+OpenThreads::Condition      FFmpegImageView::s_opened;
+FFmpegImageView::PlayerMap  FFmpegImageView::s_players;
+
+FFmpegImageView::FFmpegImageView() :
+    m_publishedModifiedCount(0)
+{
+    setOrigin(osg::Image::TOP_LEFT);
+}
+
+
+
+FFmpegImageView::FFmpegImageView(const FFmpegImageView & view, const osg::CopyOp & copyop) :
+    osg::ImageStream(view, copyop),
+    m_player(view.m_player),
+    m_publishedModifiedCount(0)
+{
+    // Copy is one more view of the same player, without audio
+    getAudioStreams().clear();
+}
+
+
+
+FFmpegImageView::~FFmpegImageView()
+{
+    OSG_INFO << "Destructing FFmpegImageView..." << std::endl;
+
+    // Player is destructed with the last view
+    getAudioStreams().clear();
+}
+
+
+
+bool FFmpegImageView::open(const std::string & filename, FFmpegParameters * parameters)
+{
+    osg::ref_ptr<FFmpegPlayer>  player;
+    bool                        isOpener = false;
+
+    setFileName(filename);
+    {
+        ScopedLock  lock(s_mutex);
+        //
+        // Player, which is released by the last view, could not be locked
+        //
+        while (true)
+        {
+            SharedPlayer &  shared = s_players[filename];
+
+            if (shared.Player.lock(player))
+                break;
+            if (shared.IsOpening == false)
+            {
+                shared.IsOpening = true;
+                isOpener = true;
+                break;
+            }
+            s_opened.wait(& s_mutex);
+        }
+    }
+    if (isOpener)
+    {
+        player = new FFmpegPlayer;
+
+        const bool  isOpened = player->open(filename, parameters);
+        {
+            ScopedLock  lock(s_mutex);
+            //
+            // Waiting views share the player, or open the file themselves if it failed
+            //
+            if (isOpened)
+            {
+                SharedPlayer &  shared = s_players[filename];
+
+                shared.Player = player.get();
+                shared.IsOpening = false;
+            }
+            else
+            {
+                s_players.erase(filename);
+            }
+            s_opened.broadcast();
+        }
+        if (isOpened == false)
+            return false;
+        //
+        // Audio is played by the first view only
+        //
+        getAudioStreams() = player->getAudioStreams();
+
+        OSG_NOTICE << "ffmpeg: decoding of " << filename << " is shared by its views" << std::endl;
+    }
+    m_player = player;
+    setPixelAspectRatio(m_player->getPixelAspectRatio());
+    setLoopingMode(m_player->getLoopingMode());
+    _status = m_player->getStatus();
+
+    return true;
+}
+
+
+
+void FFmpegImageView::play()
+{
+    if (m_player.valid())
+        m_player->play();
+    _status = PLAYING;
+}
+
+
+
+void FFmpegImageView::pause()
+{
+    if (m_player.valid())
+        m_player->pause();
+    _status = PAUSED;
+}
+
+
+
+void FFmpegImageView::rewind()
+{
+    if (m_player.valid())
+        m_player->rewind();
+}
+
+
+
+void FFmpegImageView::seek(double time)
+{
+    if (m_player.valid())
+        m_player->seek(time);
+}
+
+
+
+void FFmpegImageView::quit(bool waitForThreadToExit)
+{
+    osg::ref_ptr<FFmpegPlayer>  player;
+    {
+        ScopedLock  lock(s_mutex);
+        //
+        // Other views keep playing, while they refer to the player
+        //
+        if (m_player.valid() && m_player->referenceCount() == 1)
+            player = m_player;
+    }
+    if (player.valid())
+        player->quit(waitForThreadToExit);
+}
+
+
+
+void FFmpegImageView::setVolume(float volume)
+{
+    if (m_player.valid())
+        m_player->setVolume(volume);
+}
+
+
+
+float FFmpegImageView::getVolume() const
+{
+    return m_player.valid() ? m_player->getVolume() : 0.0f;
+}
+
+
+
+double FFmpegImageView::getLength() const
+{
+    return m_player.valid() ? m_player->getLength() : 0.0;
+}
+
+
+
+void FFmpegImageView::setReferenceTime(double time)
+{
+    if (m_player.valid())
+        m_player->setReferenceTime(time);
+}
+
+
+
+double FFmpegImageView::getReferenceTime () const
+{
+    return m_player.valid() ? m_player->getReferenceTime() : 0.0;
+}
+
+
+
+double FFmpegImageView::getCurrentTime() const
+{
+    return m_player.valid() ? m_player->getCurrentTime() : 0.0;
+}
+
+
+
+double FFmpegImageView::getFrameRate() const
+{
+    return m_player.valid() ? m_player->getFrameRate() : 0.0;
+}
+
+
+
+bool FFmpegImageView::isImageTranslucent() const
+{
+    return m_player.valid() ? m_player->isImageTranslucent() : false;
+}
+
+
+
+void FFmpegImageView::update(osg::NodeVisitor * nv)
+{
+    if (m_player.valid() == false)
+        return;
+    // Shared player is not traversed itself, so the first view in the frame updates it
+    if (m_player->requiresUpdateCall() && isPlayerUpdateDue(nv))
+        m_player->update(nv);
+    // Commands of other views change the status of the shared player
+    _status = m_player->getStatus();
+    //
+    // Image refers to the last frame of the player, without copying
+    //
+    if (m_player->data() == NULL || m_player->getModifiedCount() == m_publishedModifiedCount)
+        return;
+
+    setImage(
+        m_player->s(), m_player->t(), m_player->r(), m_player->getInternalTextureFormat(), m_player->getPixelFormat(), m_player->getDataType(),
+        m_player->data(), NO_DELETE, m_player->getPacking()
+    );
+    setPixelAspectRatio(m_player->getPixelAspectRatio());
+    m_publishedModifiedCount = m_player->getModifiedCount();
+}
+
+
+
+bool FFmpegImageView::isPlayerUpdateDue(const osg::NodeVisitor * nv) const
+{
+    const osg::FrameStamp * frameStamp = nv ? nv->getFrameStamp() : NULL;
+
+    // Frames could not be told apart without the frame stamp
+    if (frameStamp == NULL)
+        return true;
+
+    ScopedLock  lock(s_mutex);
+
+    PlayerMap::iterator it = s_players.find(getFileName());
+    if (it == s_players.end())
+        return true;
+    if (it->second.UpdatedFrameNumber == frameStamp->getFrameNumber())
+        return false;
+
+    it->second.UpdatedFrameNumber = frameStamp->getFrameNumber();
+    return true;
+}
+
+
+
+void FFmpegImageView::applyLoopingMode()
+{
+    if (m_player.valid())
+        m_player->setLoopingMode(getLoopingMode());
+}
+
+} // namespace osgFFmpeg
@@ -0,0 +1,110 @@
+/* Improved ffmpeg plugin for OpenSceneGraph -
+ * Copyright (C) 2014-2015 Digitalis Education Solutions, Inc. (http://DigitalisEducation.com)
+ * File author: Oktay Radzhabov (oradzhabov at jazzros dot com)
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+#ifndef HEADER_GUARD_FFMPEG_IMAGEVIEW_H
+#define HEADER_GUARD_FFMPEG_IMAGEVIEW_H
+
+#include <osg/ImageStream>
+#include <osg/observer_ptr>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/Condition>
+#include <OpenThreads/ScopedLock>
+#include <map>
+#include <string>
+#include "FFmpegPlayer.hpp"
+#include "FFmpegParameters.hpp"
+
+namespace osgFFmpeg {
+
+//
+// Lightweight image stream, which shows frames of FFmpegPlayer shared by all views of the same file.
+// File is decoded once, whatever number of views is, so it is used by video walls,
+// where many surfaces show the same clip in lock-step. Shared player is opened by the first view
+// with its parameters, and it is released with the last view.
+//
+// Playback commands of any view control the shared player, so all views play, pause and seek together.
+// Audio streams of the player are attached to the first view only, to be played once.
+// Image refers to the frames of the player, so it requires update traversal.
+//
+class FFmpegImageView: public osg::ImageStream
+{
+public:
+                                FFmpegImageView();
+                                FFmpegImageView(const FFmpegImageView & view,
+                                        const osg::CopyOp & copyop = osg::CopyOp::SHALLOW_COPY);
+
+    META_Object(osgFFmpeg, FFmpegImageView);
+
+    bool                        open(const std::string & filename,
+                                        FFmpegParameters * parameters);
+
+    virtual void                play();
+    virtual void                pause();
+    virtual void                rewind();
+    virtual void                seek(double time);
+    // Shared player is stopped with the last view
+    virtual void                quit(bool waitForThreadToExit = true);
+
+    virtual void                setVolume(float volume);
+    virtual float               getVolume() const;
+
+    virtual double              getLength() const;
+    // Reference time of the shared player, see FFmpegPlayer::setReferenceTime()
+    virtual void                setReferenceTime(double time);
+    virtual double              getReferenceTime () const;
+    virtual double              getCurrentTime() const;
+    virtual double              getFrameRate() const;
+
+    virtual bool                isImageTranslucent() const;
+
+    virtual bool                requiresUpdateCall() const { return true; }
+    virtual void                update(osg::NodeVisitor * nv);
+
+    FFmpegPlayer *              getPlayer() const { return m_player.get(); }
+
+private:
+    typedef OpenThreads::Mutex              Mutex;
+    typedef OpenThreads::ScopedLock<Mutex>  ScopedLock;
+    //
+    // Player is opened out of \s_mutex, as opening probes the file. Views of the same file,
+    // which come during the opening, wait for its result in \s_opened.
+    //
+    struct SharedPlayer
+    {
+        osg::observer_ptr<FFmpegPlayer> Player;
+        bool                            IsOpening;
+        unsigned int                    UpdatedFrameNumber; // player is updated once per frame by any of its views
+
+        SharedPlayer():IsOpening(false),UpdatedFrameNumber(~0u){}
+    };
+    typedef std::map<std::string, SharedPlayer>  PlayerMap;
+
+    virtual                     ~FFmpegImageView();
+    virtual void                applyLoopingMode();
+    // True if shared player is not updated in the frame of [nv] by another view yet
+    bool                        isPlayerUpdateDue(const osg::NodeVisitor * nv) const;
+
+    static Mutex                s_mutex;
+    static OpenThreads::Condition   s_opened;
+    static PlayerMap            s_players;
+
+    osg::ref_ptr<FFmpegPlayer>  m_player;
+    unsigned int                m_publishedModifiedCount;
+};
+
+} // namespace osgFFmpeg
+
+#endif // HEADER_GUARD_FFMPEG_IMAGEVIEW_H
@@ -31,16 +31,35 @@ m_audioBalance(0.0f),
 m_AudioBufferTimeSec(6),
 m_ellapsedAudioMicroSec(0),
 m_pPlayer(NULL),
-m_useRibbonTimeStrategy(true)
+m_useRibbonTimeStrategy(true),
+m_playbackRate(1.0),
+m_keyFramesOnlyRate(4.0),
+m_isNeedRefillVideo(false),
+m_isQuotaChanged(false),
+m_audioOnly(false),
+m_offline(false),
+m_durationMS(0),
+m_loopWrapped(false),
+m_prefillOnly(false)
 {
 }
 
 FFmpegLibAvStreamImpl::~FFmpegLibAvStreamImpl()
 {
     stopShadowThread();
+    // Buffer stops to receive quota notifications before members are destroyed
+    m_video_buffer.release();
 
     if (m_audio_sink.valid())
         m_audio_sink->stop();
+
+    for (size_t i = 0; i < m_extraAudio.size(); ++i)
+    {
+        if (m_extraAudio[i]->Sink.valid())
+            m_extraAudio[i]->Sink->stop();
+        delete m_extraAudio[i];
+    }
+    m_extraAudio.clear();
 }
 
 void
@@ -64,6 +83,22 @@ FFmpegLibAvStreamImpl::setAudioSink(osg::AudioSink * audio_sink)
     }
 }
 
+void
+FFmpegLibAvStreamImpl::setExtraAudioSink(const size_t trackNb, osg::AudioSink * audio_sink)
+{
+    if (trackNb >= m_extraAudio.size())
+        return;
+
+    ExtraAudioTrack *   track = m_extraAudio[trackNb];
+
+    track->Sink = audio_sink;
+    if (track->Sink.valid())
+    {
+        track->Sink->play();
+        track->Sink->pause();
+    }
+}
+
 void
 FFmpegLibAvStreamImpl::setAudioDelayMicroSec (const double & audioDelayMicroSec)
 {
@@ -80,7 +115,11 @@ FFmpegLibAvStreamImpl::initialize(const FFmpegFileHolder * pHolder, FFmpegPlayer
     m_audioIndex = pHolder->audioIndex();
     m_videoIndex = pHolder->videoIndex();
     m_pPlayer = pPlayer;
+    m_audioOnly = pHolder->isAudioOnly();
+    m_offline = pHolder->isOffline();
+    m_durationMS = pHolder->duration_ms();
     m_isNeedFlushBuffers = true;
+    m_isNeedRefillVideo = false;
 
     if (isHasAudio())
     {
@@ -97,13 +136,40 @@ FFmpegLibAvStreamImpl::initialize(const FFmpegFileHolder * pHolder, FFmpegPlayer
 
             av_log(NULL, AV_LOG_ERROR, "Cannot alloc audio buffer");
         }
+        m_driftCompensator.reset(m_audioFormat.m_sampleRate);
+    }
+    //
+    for (size_t i = 0; i < m_extraAudio.size(); ++i)
+        delete m_extraAudio[i];
+    m_extraAudio.clear();
+
+    for (size_t i = 0; i < pHolder->extraAudioNb(); ++i)
+    {
+        ExtraAudioTrack *   track = new ExtraAudioTrack();
+
+        track->Index = pHolder->extraAudioIndex(i);
+        track->Format = pHolder->getExtraAudioFormat(i);
+        track->BlockSize = 0;
+        track->BufferingFinished = true;
+
+        if (track->Buffer.alloc ( track->Format.m_sampleRate *
+                                    track->Format.m_channelsNb *
+                                    track->Format.m_bytePerSample *
+                                    m_AudioBufferTimeSec) < 0)
+        {
+            track->Buffer.release();
+            track->Index = -1;
+
+            av_log(NULL, AV_LOG_ERROR, "Cannot alloc buffer of audio track %d", (int)(i + 1));
+        }
+        m_extraAudio.push_back(track);
     }
     //
     if (isHasVideo())
     {
         m_frame_rate = pHolder->frameRate();
 
-        if (m_video_buffer.alloc(pHolder) < 0)
+        if (m_video_buffer.alloc(pHolder, this) < 0)
         {
             m_video_buffer.release();
             m_videoIndex = -1;
@@ -130,6 +196,7 @@ void
 FFmpegLibAvStreamImpl::loop(const bool loop)
 {
     m_loop = loop;
+    m_video_buffer.setLoop(isGaplessLoop());
 }
 
 const bool
@@ -141,7 +208,23 @@ FFmpegLibAvStreamImpl::loop() const
 const unsigned long
 FFmpegLibAvStreamImpl::GetPlaybackTime() const
 {
-    if (isHasAudio())
+    return wrapLoopTime(GetClockTime());
+}
+
+const unsigned long
+FFmpegLibAvStreamImpl::GetClockTime() const
+{
+    osg::ref_ptr<FFmpegIClock>  clock;
+    {
+        ScopedLock  lock (m_mutex);
+
+        clock = m_clock;
+    }
+    // External clock is asked out of the lock, because it could lock own mutex
+    if (clock.valid())
+        return clock->GetClockTime();
+
+    if (isAudioActive())
     {
         ScopedLock  lock (m_mutex);
 
@@ -154,6 +237,14 @@ FFmpegLibAvStreamImpl::GetPlaybackTime() const
     return m_playerTimer.ElapsedMilliseconds ();
 }
 
+void
+FFmpegLibAvStreamImpl::setClock(FFmpegIClock * clock)
+{
+    ScopedLock  lock (m_mutex);
+
+    m_clock = clock;
+}
+
 void
 FFmpegLibAvStreamImpl::Start()
 {
@@ -169,11 +260,27 @@ FFmpegLibAvStreamImpl::Start()
         // To avoid thread concurent conflicts, follow param should be
         // defined from parent thread
         m_shadowThreadStop = false;
+        m_prefillOnly = false;
         // start thread
         start();
     }
 }
 
+void
+FFmpegLibAvStreamImpl::Prefill()
+{
+    av_log(NULL, AV_LOG_INFO, "FFmpegLibAvStreamImpl::Prefill()");
+    //
+    // Buffers are kept when thread stops, so Start() continues from prefilled data
+    //
+    if (isRunning() == false)
+    {
+        m_shadowThreadStop = false;
+        m_prefillOnly = true;
+        start();
+    }
+}
+
 void
 FFmpegLibAvStreamImpl::Pause()
 {
@@ -203,6 +310,72 @@ FFmpegLibAvStreamImpl::Seek(const unsigned long & newTimeMS)
     m_ellapsedAudioMicroSecOffsetInitial = 0;
 }
 
+void
+FFmpegLibAvStreamImpl::setPlaybackRate(const double & rate)
+{
+    if (isRunning())
+        Pause();
+    //
+    // Changing of the rate requires to rebuild buffers (playback direction, key-frames only decoding, audio muting),
+    // so it is processed as seeking to the current position.
+    //
+    const unsigned long currTimeMS = wrapLoopTime(m_playerTimer.ElapsedMilliseconds());
+
+    m_playbackRate = rate;
+    m_playerTimer.PlaybackRate(rate);
+
+    Seek(currTimeMS);
+}
+
+const double
+FFmpegLibAvStreamImpl::getPlaybackRate() const
+{
+    return m_playbackRate;
+}
+
+const int
+FFmpegLibAvStreamImpl::Step(const int direction)
+{
+    if (isHasVideo() == false)
+        return -1;
+
+    if (isRunning())
+        Pause();
+
+    const unsigned long currTimeMS = wrapLoopTime(m_playerTimer.ElapsedMilliseconds());
+    double              timeStampSec = 0.0;
+    short               sErr;
+    {
+        // Stopped buffer could be resized by quota of other players
+        ScopedLock          quotaLock (m_quotaMutex);
+        //
+        // Stepped frame is placed into the first frame of flushed buffer, same as seek does
+        //
+        m_video_buffer.flush();
+
+        unsigned char *     pFrame;
+
+        m_video_buffer.GetFramePtr(0, pFrame, true);
+        sErr = FFmpegWrapper::stepImage(m_videoIndex, direction, currTimeMS, pFrame, timeStampSec);
+        m_video_buffer.ReleaseFoundFrame();
+    }
+
+    if (sErr < 0)
+        return sErr;
+    //
+    // Next playback starts from the stepped frame
+    //
+    Seek((unsigned long)(std::max(0.0, timeStampSec) * 1000.0 + 0.5));
+
+    return 0;
+}
+
+void
+FFmpegLibAvStreamImpl::setVisible(const bool visible)
+{
+    m_video_buffer.setVisible(visible);
+}
+
 const bool
 FFmpegLibAvStreamImpl::detectIsItImplementedAudioVolume()
 {
@@ -285,6 +458,16 @@ FFmpegLibAvStreamImpl::isHasAudio() const
     return m_audioIndex >= 0;
 }
 
+const bool
+FFmpegLibAvStreamImpl::isAudioActive() const
+{
+    //
+    // Audio has not time-stretching, so it is muted during trick-play
+    // and playback time is driven by timer. Offline playback is not real-time, so audio is muted too.
+    //
+    return isHasAudio() && m_playbackRate == 1.0 && m_offline == false;
+}
+
 void
 FFmpegLibAvStreamImpl::GetAudio(void * buffer, int bytesLength)
 {
@@ -292,59 +475,14 @@ FFmpegLibAvStreamImpl::GetAudio(void * buffer, int bytesLength)
     //
     const double            playbackSec = (double)playbackBytes / (double)(m_audioFormat.m_sampleRate * m_audioFormat.m_bytePerSample * m_audioFormat.m_channelsNb);
     //
+    // Rate of sink's requests (even if buffer is empty) gives the clock of sound card
+    //
+    m_driftCompensator.update(bytesLength / (m_audioFormat.m_bytePerSample * m_audioFormat.m_channelsNb));
+    //
     // Multiply samples by master/balanced volume
     //
     if (m_audio_sink.valid())
-    {
-        unsigned long       sampleInd;
-        const unsigned long playBackSamples             = playbackBytes / m_audioFormat.m_bytePerSample;
-        // [0..1]
-        // Warning: Do not forget implement functions "setVolume(float)" and "float getVolume() const"
-        // for subclass of AudioSink.
-        const float         audioMaterVolume            = getAudioVolume ();
-        // balance of the audio: -1 = left, 0 = center,  1 = right
-        const float         audioBallance               = m_audioBalance;
-        //
-        float               audioVolumeChannel[128];
-        audioVolumeChannel[0] = audioMaterVolume - ((audioBallance > 0.0f) ? (audioBallance * audioMaterVolume) : 0.0f);
-        audioVolumeChannel[1] = audioMaterVolume + ((audioBallance < 0.0f) ? (audioBallance * audioMaterVolume) : 0.0f);
-        audioVolumeChannel[2] = audioMaterVolume;
-        audioVolumeChannel[3] = audioMaterVolume;
-        audioVolumeChannel[4] = audioVolumeChannel[0];
-        audioVolumeChannel[5] = audioVolumeChannel[1];
-
-        switch (m_audioFormat.m_avSampleFormat)
-        {
-        case AV_SAMPLE_FMT_U8:
-            {
-                uint8_t *           ptr = (uint8_t *)buffer;
-                for (sampleInd = 0; sampleInd < playBackSamples; ++sampleInd, ++ptr)
-                    (*ptr) *= audioVolumeChannel[sampleInd % m_audioFormat.m_channelsNb];
-                break;
-            }
-        case AV_SAMPLE_FMT_S16:
-            {
-                int16_t *           ptr = (int16_t *)buffer;
-                for (sampleInd = 0; sampleInd < playBackSamples; ++sampleInd, ++ptr)
-                    (*ptr) *= audioVolumeChannel[sampleInd % m_audioFormat.m_channelsNb];
-                break;
-            }
-        case AV_SAMPLE_FMT_S32:
-            {
-                int32_t *           ptr = (int32_t *)buffer;
-                for (sampleInd = 0; sampleInd < playBackSamples; ++sampleInd, ++ptr)
-                    (*ptr) *= audioVolumeChannel[sampleInd % m_audioFormat.m_channelsNb];
-                break;
-            }
-        case AV_SAMPLE_FMT_FLT:
-            {
-                float *             ptr = (float *)buffer;
-                for (sampleInd = 0; sampleInd < playBackSamples; ++sampleInd, ++ptr)
-                    (*ptr) *= audioVolumeChannel[sampleInd % m_audioFormat.m_channelsNb];
-                break;
-            }
-        };
-    }
+        applyAudioVolume(buffer, playbackBytes, m_audioFormat);
     //
     // Signal thread that audio needs new samples
     // To avoid overloading the grabbing thread, signals when free space more than half of buffer-size
@@ -372,17 +510,141 @@ FFmpegLibAvStreamImpl::GetAudio(void * buffer, int bytesLength)
     // fprintf (stdout, "m_ellapsedAudioMicroSec = %d\n", m_ellapsedAudioMicroSec);
 }
 
+void
+FFmpegLibAvStreamImpl::GetExtraAudio(const size_t trackNb, void * buffer, int bytesLength)
+{
+    if (trackNb >= m_extraAudio.size())
+    {
+        memset(buffer, 0, bytesLength);
+        return;
+    }
+    ExtraAudioTrack *       track = m_extraAudio[trackNb];
+    const unsigned long     playbackBytes = track->Buffer.read (buffer, bytesLength);
+
+    if (track->Sink.valid())
+        applyAudioVolume(buffer, playbackBytes, track->Format);
+
+    if (track->Buffer.freeSpaceSize() > track->Buffer.size() / 2)
+        m_threadLocker.signal();
+}
+
+void
+FFmpegLibAvStreamImpl::applyAudioVolume(void * buffer, const unsigned long bytesNb, const AudioFormat & format) const
+{
+    unsigned long       sampleInd;
+    const unsigned long playBackSamples             = bytesNb / format.m_bytePerSample;
+    // [0..1]
+    // Warning: Do not forget implement functions "setVolume(float)" and "float getVolume() const"
+    // for subclass of AudioSink.
+    const float         audioMaterVolume            = getAudioVolume ();
+    // balance of the audio: -1 = left, 0 = center,  1 = right
+    const float         audioBallance               = m_audioBalance;
+    //
+    float               audioVolumeChannel[128];
+    audioVolumeChannel[0] = audioMaterVolume - ((audioBallance > 0.0f) ? (audioBallance * audioMaterVolume) : 0.0f);
+    audioVolumeChannel[1] = audioMaterVolume + ((audioBallance < 0.0f) ? (audioBallance * audioMaterVolume) : 0.0f);
+    audioVolumeChannel[2] = audioMaterVolume;
+    audioVolumeChannel[3] = audioMaterVolume;
+    audioVolumeChannel[4] = audioVolumeChannel[0];
+    audioVolumeChannel[5] = audioVolumeChannel[1];
+
+    switch (format.m_avSampleFormat)
+    {
+    case AV_SAMPLE_FMT_U8:
+        {
+            uint8_t *           ptr = (uint8_t *)buffer;
+            for (sampleInd = 0; sampleInd < playBackSamples; ++sampleInd, ++ptr)
+                (*ptr) *= audioVolumeChannel[sampleInd % format.m_channelsNb];
+            break;
+        }
+    case AV_SAMPLE_FMT_S16:
+        {
+            int16_t *           ptr = (int16_t *)buffer;
+            for (sampleInd = 0; sampleInd < playBackSamples; ++sampleInd, ++ptr)
+                (*ptr) *= audioVolumeChannel[sampleInd % format.m_channelsNb];
+            break;
+        }
+    case AV_SAMPLE_FMT_S32:
+        {
+            int32_t *           ptr = (int32_t *)buffer;
+            for (sampleInd = 0; sampleInd < playBackSamples; ++sampleInd, ++ptr)
+                (*ptr) *= audioVolumeChannel[sampleInd % format.m_channelsNb];
+            break;
+        }
+    case AV_SAMPLE_FMT_FLT:
+        {
+            float *             ptr = (float *)buffer;
+            for (sampleInd = 0; sampleInd < playBackSamples; ++sampleInd, ++ptr)
+                (*ptr) *= audioVolumeChannel[sampleInd % format.m_channelsNb];
+            break;
+        }
+    };
+}
+
+const int
+FFmpegLibAvStreamImpl::grabAudio(const long audioIndex, const AudioFormat & format, AudioBuffer & buffer, const unsigned int maxBytes, unsigned char * pAudioData, const double & max_avail_time_micros)
+{
+    const unsigned int  sampleSize = format.m_bytePerSample * format.m_channelsNb;
+#ifdef OSG_AUDIO_DIRECT_RESAMPLE
+    //
+    // Free space of the ring could be wrapped, so fill it by two spans
+    //
+    unsigned char *     spanPtr[2];
+    unsigned int        spanSize[2];
+    int                 bytesread = 0;
+
+    buffer.reserve(maxBytes, spanPtr[0], spanSize[0], spanPtr[1], spanSize[1]);
+    for (size_t i = 0; i < 2; ++i)
+    {
+        const unsigned long spanSamples = spanSize[i] / sampleSize;
+        if (spanSamples == 0)
+            break;
+
+        const int samplesread = FFmpegWrapper::getAudioSamples(audioIndex,
+                                                                123456789,
+                                                                format.m_channelsNb,
+                                                                format.m_avSampleFormat,
+                                                                format.m_sampleRate,
+                                                                spanSamples,
+                                                                spanPtr[i],
+                                                                max_avail_time_micros);
+        if (samplesread < 0)
+            return -1;
+
+        bytesread += samplesread * sampleSize;
+        if ((unsigned long)samplesread < spanSamples)
+            break;
+    }
+    if (bytesread > 0)
+        buffer.commit (bytesread);
+#else
+    const int bytesread = FFmpegWrapper::getAudioSamples(audioIndex,
+                                                            123456789,
+                                                            format.m_channelsNb,
+                                                            format.m_avSampleFormat,
+                                                            format.m_sampleRate,
+                                                            maxBytes / sampleSize,
+                                                            pAudioData,
+                                                            max_avail_time_micros) * sampleSize;
+    if (bytesread > 0)
+        buffer.write (pAudioData, bytesread);
+#endif // OSG_AUDIO_DIRECT_RESAMPLE
+    return bytesread;
+}
+
 int
 FFmpegLibAvStreamImpl::GetFramePtr(const unsigned long & timePosMS, unsigned char *& pArray)
 {
     pArray = NULL;
     int err = 0;
+    // Offline rendering requires every frame, so grabbing is never forced ahead
+    const bool  useRibbonTimeStrategy = (m_useRibbonTimeStrategy || m_offline);
     try
     {
-        err = m_video_buffer.GetFramePtr (timePosMS, pArray, m_useRibbonTimeStrategy);
+        err = m_video_buffer.GetFramePtr (timePosMS, pArray, useRibbonTimeStrategy);
         if (err != 0)
         {
-            if (m_useRibbonTimeStrategy == false)
+            if (useRibbonTimeStrategy == false)
             {
                 // To unlock grabbing stream(and avoid deadlock)
                 // here we have to flush buffer
@@ -414,6 +676,38 @@ FFmpegLibAvStreamImpl::ReleaseFoundFrame()
     m_threadLocker.signal();
 }
 
+const int
+FFmpegLibAvStreamImpl::RenderFrame(const unsigned long & timePosMS)
+{
+    if (isHasVideo() == false)
+        return -1;
+
+    ScopedLock      lock (m_frameMutex);
+    unsigned char * pFramePtr;
+
+    //
+    // Paused player shows the best buffered frame. Otherwise passed frames are released
+    // without rendering, so grabbing continues up to the required frame. If grabbing
+    // could not reach the frame(stream is finished or buffer is full anyway), the nearest frame is shown.
+    //
+    while (isRunning() && m_video_buffer.isFrameReady(timePosMS) == false)
+    {
+        if (m_video_buffer.releasePassedFrames(timePosMS))
+            m_threadLocker.signal();
+
+        if (m_video_buffer.isStreamFinished() || m_video_buffer.isBufferFull())
+            break;
+
+        m_frameWritten.wait(& m_frameMutex, 10);
+    }
+    GetFramePtr(timePosMS, pFramePtr);
+    if (pFramePtr != NULL)
+        m_renderer.PublishFrame(pFramePtr);
+    ReleaseFoundFrame();
+
+    return (pFramePtr != NULL) ? 0 : -1;
+}
+
 const bool
 FFmpegLibAvStreamImpl::isHasVideo() const
 {
@@ -450,6 +744,17 @@ FFmpegLibAvStreamImpl::preRun()
     m_ellapsedAudioMicroSec = 0;
     m_ellapsedAudioMicroSecOffsetInitial = 0;
     //
+    // Flushed buffers start new loop from the position in the file. Otherwise the clock continues
+    // from the paused moment, and grabbing continues the current loop generation.
+    //
+    if (m_isNeedFlushBuffers == true)
+    {
+        elapsedTimeMS = wrapLoopTime(elapsedTimeMS);
+        m_playerTimer.ElapsedMilliseconds(elapsedTimeMS);
+        m_loopWrapped = false;
+        m_audioLoopBytes = 0;
+    }
+    //
     // Because Video-seeking may be non-accurate(for speed-performance), actual playback time-stamp
     // may be corrected during seeking. So firstable seeking the video.
     //
@@ -457,9 +762,25 @@ FFmpegLibAvStreamImpl::preRun()
     //
     if (isHasVideo())
     {
+        //
+        // Playing video gets more frames from the memory budget
+        //
+        m_video_buffer.setPlaying(true);
+        m_video_buffer.setLoop(isGaplessLoop());
+        {
+            ScopedLock  quotaLock (m_quotaMutex);
+
+            m_isQuotaChanged = false;
+            if (applyMemoryQuota())
+                m_isNeedRefillVideo = true;
+        }
+
         if (m_isNeedFlushBuffers == true)
         {
             m_video_buffer.flush();
+            m_video_buffer.setLoopGeneration(0);
+
+            FFmpegWrapper::setVideoKeyFramesOnly(m_videoIndex, fabs(m_playbackRate) >= m_keyFramesOnlyRate);
 
             unsigned char * pFrame;
             // todo: should be processed to error
@@ -477,7 +798,16 @@ FFmpegLibAvStreamImpl::preRun()
             {
                 m_video_buffer.setStreamFinished (true);
             }
+            //
+            // Reverse playback starts from the key-frame found by fast-video-seek
+            //
+            m_video_buffer.setReverse(m_playbackRate < 0.0, elapsedTimeMS + 1.0);
+        }
+        else if (m_isNeedRefillVideo == true)
+        {
+            refillVideo(elapsedTimeMS);
         }
+        m_isNeedRefillVideo = false;
     }
     //
     // Prepare Audio to streaming
@@ -496,8 +826,9 @@ FFmpegLibAvStreamImpl::preRun()
 
                 m_audio_buffer.flush();
             }
+            m_driftCompensator.restart();
 
-            m_audio_buffering_finished = false;
+            m_audio_buffering_finished = (isAudioActive() == false);
         }
         else
         {
@@ -510,6 +841,79 @@ FFmpegLibAvStreamImpl::preRun()
             m_audioIndex = -1;
         }
     }
+    for (size_t i = 0; i < m_extraAudio.size(); ++i)
+    {
+        ExtraAudioTrack *   track = m_extraAudio[i];
+
+        track->BufferingFinished = true;
+        if (track->Index >= 0 && track->Sink.valid())
+        {
+            if (m_isNeedFlushBuffers == true)
+            {
+                FFmpegWrapper::seekAudio(track->Index, elapsedTimeMS);
+
+                track->Buffer.flush();
+            }
+            track->BufferingFinished = (isAudioActive() == false);
+        }
+    }
+}
+
+void
+FFmpegLibAvStreamImpl::refillVideo(const unsigned long & elapsedTimeMS)
+{
+    //
+    // Buffer has been resized, so it continues from the displayed frame.
+    // Accurate seek is used to avoid jump to key-frame.
+    //
+    // Frames of the looped playback are grabbed in the generation of the clock.
+    //
+    const unsigned long fileTimeMS = wrapLoopTime(elapsedTimeMS);
+    const unsigned long loopGeneration = (m_durationMS > 0) ? (elapsedTimeMS - fileTimeMS) / m_durationMS : 0;
+    unsigned char * pFrame;
+    m_video_buffer.GetFramePtr(0, pFrame, true);
+
+    const short sErr = FFmpegWrapper::getImage(m_videoIndex, fileTimeMS, pFrame);
+    m_video_buffer.ReleaseFoundFrame();
+    m_video_buffer.setLoopGeneration(loopGeneration);
+
+    if (sErr < 0)
+        m_video_buffer.setStreamFinished (true);
+
+    m_video_buffer.setReverse(m_playbackRate < 0.0, fileTimeMS + 1.0);
+}
+
+const bool
+FFmpegLibAvStreamImpl::applyMemoryQuota()
+{
+    if (m_video_buffer.applyMemoryQuota() == false)
+        return false;
+    //
+    // Pool could be reallocated, so displayed frame is published from its new place
+    //
+    unsigned char * pFramePtr = m_video_buffer.lastFramePtr();
+    if (pFramePtr != NULL)
+        m_renderer.PublishFrame(pFramePtr);
+
+    return true;
+}
+
+void
+FFmpegLibAvStreamImpl::onFrameQuotaChanged()
+{
+    ScopedLock  lock (m_quotaMutex);
+    //
+    // Running thread resizes the buffer itself. Stopped buffer is resized at once, and it is refilled by next start
+    //
+    if (isRunning())
+    {
+        m_isQuotaChanged = true;
+        m_threadLocker.signal();
+    }
+    else if (applyMemoryQuota())
+    {
+        m_isNeedRefillVideo = true;
+    }
 }
 
 void
@@ -520,11 +924,31 @@ FFmpegLibAvStreamImpl::postRun()
     if (m_audio_sink.valid())
         m_audio_sink->pause();
 
+    for (size_t i = 0; i < m_extraAudio.size(); ++i)
+    {
+        if (m_extraAudio[i]->Sink.valid())
+            m_extraAudio[i]->Sink->pause();
+    }
+
     m_playerTimer.Stop();
     //
+    // Paused video gives its frames back to the memory budget.
+    // Prefilled frames are kept for Start(), which follows prefilling, so the buffer keeps quota of the playing one.
+    //
+    if (isHasVideo() && m_prefillOnly == false)
+    {
+        m_video_buffer.setPlaying(false);
+
+        ScopedLock  quotaLock (m_quotaMutex);
+
+        m_isQuotaChanged = false;
+        if (applyMemoryQuota())
+            m_isNeedRefillVideo = true;
+    }
+    //
     // Reset Audio timing, so next Start will starts from the stopped audio moment
     //
-    if (isHasAudio() && m_audio_sink.valid())
+    if (isAudioActive() && m_audio_sink.valid())
     {
         m_playerTimer.Reset();
         m_playerTimer.ElapsedMilliseconds (m_ellapsedAudioMicroSec / 1000.0);
@@ -544,27 +968,154 @@ FFmpegLibAvStreamImpl::postRun()
         m_ellapsedAudioMicroSec = 0;
         m_ellapsedAudioMicroSecOffsetInitial = 0;
 
-        if (m_pPlayer)
+        if (m_pPlayer && (m_audioOnly || m_offline))
+        {
+            //
+            // Audio-only and offline players have no control thread, and this thread could not restart
+            // itself by player's commands. So audio is rewound here, and next play() starts from ZERO-time point.
+            //
+            rewindAudio();
+            m_pPlayer->playbackFinished();
+
+            if (m_audio_sink.valid() && m_offline == false)
+                m_audio_sink->play(); // Cover edge case of paused audio sink still holding buffered data.
+        }
+        else if (m_pPlayer)
         {
             m_pPlayer->pause();
-            m_pPlayer->rewind();
-            if (m_loop)
-                m_pPlayer->play();
+            if (m_playbackRate < 0.0)
+            {
+                //
+                // Reverse playback finished at ZERO-time point, so looping continues from the end
+                //
+                if (m_loop)
+                {
+                    m_pPlayer->seek(std::max(0.0, m_pPlayer->getLength() - 1000.0 / m_frame_rate));
+                    m_pPlayer->play();
+                }
+            }
             else
             {
-                if (m_audio_sink.valid())
-                    m_audio_sink->play(); // Cover edge case of paused audio sink still holding buffered data.
+                m_pPlayer->rewind();
+                if (m_loop)
+                    m_pPlayer->play();
+                else
+                {
+                    if (m_audio_sink.valid())
+                        m_audio_sink->play(); // Cover edge case of paused audio sink still holding buffered data.
+                }
             }
         }
     }
 }
 
+void
+FFmpegLibAvStreamImpl::rewindAudio()
+{
+    m_playerTimer.Reset();
+    m_playerTimer.ElapsedMilliseconds (0);
+    m_ellapsedAudioMicroSec = 0;
+    m_ellapsedAudioMicroSecOffsetInitial = 0;
+    m_loopWrapped = false;
+    m_audioLoopBytes = 0;
+
+    if (isHasAudio())
+    {
+        FFmpegWrapper::seekAudio(m_audioIndex, 0);
+        m_audio_buffer.flush();
+        m_audio_buffering_finished = (isAudioActive() == false);
+    }
+    for (size_t i = 0; i < m_extraAudio.size(); ++i)
+    {
+        ExtraAudioTrack *   track = m_extraAudio[i];
+
+        if (track->Index >= 0 && track->Sink.valid())
+        {
+            FFmpegWrapper::seekAudio(track->Index, 0);
+            track->Buffer.flush();
+            track->BufferingFinished = (isAudioActive() == false);
+        }
+    }
+}
+
+const bool
+FFmpegLibAvStreamImpl::isGaplessLoop() const
+{
+    return m_loop && m_playbackRate > 0.0 && m_durationMS > 0;
+}
+
+const unsigned long
+FFmpegLibAvStreamImpl::wrapLoopTime(const unsigned long & clockTimeMS) const
+{
+    if (m_loopWrapped == false || m_durationMS == 0 || clockTimeMS <= m_durationMS)
+        return clockTimeMS;
+
+    return clockTimeMS % m_durationMS;
+}
+
+const bool
+FFmpegLibAvStreamImpl::loopAudio()
+{
+    const unsigned int          sampleSize = m_audioFormat.m_bytePerSample * m_audioFormat.m_channelsNb;
+    const unsigned long long    periodBytes = (unsigned long long)((double)m_durationMS * m_audioFormat.m_sampleRate / 1000.0) * sampleSize;
+    //
+    // Audio could be shorter than the file, so it is padded by silence up to the duration.
+    // Otherwise audio clock, which drives the playback, leaves time-stamps of looped video frames.
+    //
+    if (m_audioLoopBytes < periodBytes)
+    {
+        //
+        // Ring keeps one byte free, so silence is limited by the space reserve() gives out.
+        // Partial sample would shift all following samples of the ring.
+        //
+        const unsigned int  spaceBytes = m_audio_buffer.freeSpaceSize();
+        const unsigned int  freeBytes = (spaceBytes > 0 ? spaceBytes - 1 : 0) / sampleSize * sampleSize;
+        const unsigned int  silenceBytes = (unsigned int)std::min((unsigned long long)freeBytes, periodBytes - m_audioLoopBytes);
+        const int           silence = (m_audioFormat.m_avSampleFormat == AV_SAMPLE_FMT_U8 ||
+                                        m_audioFormat.m_avSampleFormat == AV_SAMPLE_FMT_U8P) ? 0x80 : 0;
+        unsigned char *     spanPtr[2];
+        unsigned int        spanSize[2];
+
+        const unsigned int  reservedBytes = m_audio_buffer.reserve(silenceBytes, spanPtr[0], spanSize[0], spanPtr[1], spanSize[1]) / sampleSize * sampleSize;
+        for (size_t i = 0; i < 2; ++i)
+        {
+            if (spanSize[i] > 0)
+                memset(spanPtr[i], silence, spanSize[i]);
+        }
+        m_audio_buffer.commit(reservedBytes);
+        m_audioLoopBytes += reservedBytes;
+
+        if (m_audioLoopBytes < periodBytes)
+            return true;
+    }
+    //
+    // Tracks are demuxed together with the main audio, so they are wrapped by the same seeking
+    //
+    if (FFmpegWrapper::seekAudio(m_audioIndex, 0) < 0)
+        return false;
+
+    for (size_t i = 0; i < m_extraAudio.size(); ++i)
+    {
+        ExtraAudioTrack *   track = m_extraAudio[i];
+
+        if (track->Index >= 0 && track->Sink.valid())
+        {
+            FFmpegWrapper::seekAudio(track->Index, 0);
+            track->BufferingFinished = false;
+        }
+    }
+    m_audioLoopBytes = 0;
+    m_loopWrapped = true;
+
+    return true;
+}
+
 void
 FFmpegLibAvStreamImpl::startPlayback()
 {
     m_playerTimer.Start();
     //
-    if (isHasAudio() &&
+    if (isAudioActive() &&
         m_audio_sink.valid() &&
         m_audio_sink->playing() == false)
     {
@@ -572,7 +1123,17 @@ FFmpegLibAvStreamImpl::startPlayback()
         //
         m_audio_sink->play();
     }
-    if (isHasVideo() && m_video_buffer.isStreamFinished() == false)
+    for (size_t i = 0; i < m_extraAudio.size(); ++i)
+    {
+        ExtraAudioTrack *   track = m_extraAudio[i];
+
+        if (isAudioActive() &&
+            track->Sink.valid() &&
+            track->Sink->playing() == false)
+            track->Sink->play();
+    }
+    // Offline frames are rendered by RenderFrame() in the thread of the application
+    if (isHasVideo() && m_video_buffer.isStreamFinished() == false && m_offline == false)
         m_renderer.Start();
 }
 
@@ -580,7 +1141,7 @@ const bool
 FFmpegLibAvStreamImpl::isPlaybackFinished()
 {
     // Audio finish playback
-    if (isHasAudio())
+    if (isAudioActive())
     {
         if (m_audio_buffering_finished == true &&
             m_audio_buffer.size() == m_audio_buffer.freeSpaceSize())//audio buffer is empty, playback finished
@@ -588,10 +1149,18 @@ FFmpegLibAvStreamImpl::isPlaybackFinished()
     }
     else
     {
-        const unsigned long elapsedTimeMS   = m_playerTimer.ElapsedMilliseconds();
-        const double        duration_ms     = m_pPlayer->getLength();
+        // Video finishes by the time of external clock, if it is attached
+        const unsigned long elapsedTimeMS   = GetClockTime();
+        // Looped video finishes at the end of the last grabbed generation
+        const double        duration_ms     = m_pPlayer->getLength() * (m_video_buffer.loopGeneration() + 1);
 
-        if (elapsedTimeMS >= duration_ms)
+        if (m_playbackRate < 0.0)
+        {
+            // Reverse playback finishes at ZERO-time point
+            if (elapsedTimeMS == 0)
+                return true;
+        }
+        else if (elapsedTimeMS >= duration_ms)
             return true;
     }
     return false;
@@ -609,7 +1178,23 @@ FFmpegLibAvStreamImpl::run()
     // limited by 32767 as restriction of ffmpeg-wrapper
     const unsigned short    samplesPart = std::min((double)32767, (double)(m_audioFormat.m_bytePerSample * m_audioFormat.m_channelsNb * m_audioFormat.m_sampleRate) / m_frame_rate * 2);
     const unsigned int      minBlockSize = samplesPart * m_audioFormat.m_bytePerSample * m_audioFormat.m_channelsNb;
+    unsigned int            maxExtraBlockSize = 0;
+    for (size_t i = 0; i < m_extraAudio.size(); ++i)
+    {
+        const AudioFormat & format = m_extraAudio[i]->Format;
+        const unsigned int  samples = std::min((double)32767, (double)(format.m_bytePerSample * format.m_channelsNb * format.m_sampleRate) / m_frame_rate * 2);
+
+        m_extraAudio[i]->BlockSize = samples * format.m_bytePerSample * format.m_channelsNb;
+        maxExtraBlockSize = std::max(maxExtraBlockSize, m_extraAudio[i]->BlockSize);
+    }
+#ifdef OSG_AUDIO_DIRECT_RESAMPLE
+    // Resampler writes to the audio buffer directly, because it never returns more than required
+    unsigned char *         pAudioData = NULL;
+    unsigned char *         pExtraAudioData = NULL;
+#else
     unsigned char *         pAudioData = minBlockSize > 0 ? new unsigned char[minBlockSize * 2] : NULL; // ... * 2], because it could read more than minBlockSize
+    unsigned char *         pExtraAudioData = maxExtraBlockSize > 0 ? new unsigned char[maxExtraBlockSize * 2] : NULL;
+#endif // OSG_AUDIO_DIRECT_RESAMPLE
     try
     {
         //
@@ -625,9 +1210,25 @@ FFmpegLibAvStreamImpl::run()
             audioGrabbingInProcess = false;
             videoGrabbingInProcess = false;
             //
-            // Grab Audio Buffer
+            // Quota has been changed by other players. Rendering is stopped while the pool is resized,
+            // then buffer continues from the frame of the clock.
+            //
+            if (m_isQuotaChanged && isHasVideo())
+            {
+                ScopedLock  quotaLock (m_quotaMutex);
+
+                m_isQuotaChanged = false;
+                m_renderer.Stop();
+                if (applyMemoryQuota())
+                    refillVideo(GetClockTime());
+
+                if (isPlaybackStarted && m_offline == false && m_video_buffer.isStreamFinished() == false)
+                    m_renderer.Start();
+            }
+            //
+            // Grab Audio Buffer. Offline playback does not play audio
             //
-            if (isHasAudio() && pAudioData != NULL)
+            if (isHasAudio() && minBlockSize > 0 && m_offline == false)
             {
                 const unsigned int space_audio_size = m_audio_buffer.freeSpaceSize();
 
@@ -637,7 +1238,7 @@ FFmpegLibAvStreamImpl::run()
                     //
                     // Limit audio-grabbing by time to avoid video artifacts
                     //
-                    if (isPlaybackStarted)
+                    if (isPlaybackStarted && isHasVideo())
                     {
                         //
                         // 1. To avoid audio-artifacts, we should guaranty that audio-buffer filled.
@@ -664,17 +1265,16 @@ FFmpegLibAvStreamImpl::run()
                                 videoWriteFlag |= 1; // disable decoding during searching
                         }
                     }
-                    const int bytesread = FFmpegWrapper::getAudioSamples(m_audioIndex,
-                                                                            123456789,
-                                                                            m_audioFormat.m_channelsNb,
-                                                                            m_audioFormat.m_avSampleFormat,
-                                                                            m_audioFormat.m_sampleRate,
-                                                                            samplesPart,
-                                                                            pAudioData,
-                                                                            max_avail_time_micros) * m_audioFormat.m_bytePerSample * m_audioFormat.m_channelsNb;
+                    FFmpegWrapper::setAudioDriftCompensation(m_audioIndex, m_driftCompensator.compensation());
+
+                    const int bytesread = grabAudio(m_audioIndex, m_audioFormat, m_audio_buffer, minBlockSize, pAudioData, max_avail_time_micros);
                     if (bytesread > 0)
                     {
-                        m_audio_buffer.write (pAudioData, bytesread);
+                        audioGrabbingInProcess = true;
+                        m_audioLoopBytes += bytesread;
+                    }
+                    else if (bytesread == 0 && isGaplessLoop() && loopAudio())
+                    {
                         audioGrabbingInProcess = true;
                     }
                     else
@@ -686,6 +1286,31 @@ FFmpegLibAvStreamImpl::run()
                 }
             }
             //
+            // Grab extra audio tracks
+            //
+            for (size_t i = 0; m_offline == false && i < m_extraAudio.size(); ++i)
+            {
+                ExtraAudioTrack *   track = m_extraAudio[i];
+
+                if (track->BufferingFinished == false &&
+                    track->BlockSize > 0 &&
+                    track->Buffer.freeSpaceSize() > track->BlockSize)
+                {
+                    const int bytesread = grabAudio(track->Index, track->Format, track->Buffer, track->BlockSize, pExtraAudioData, -1.0);
+                    if (bytesread > 0)
+                    {
+                        audioGrabbingInProcess = true;
+                    }
+                    else
+                    {
+                        // Failed extra track should not stop the playback
+                        track->BufferingFinished = true;
+                        if (bytesread < 0)
+                            av_log(NULL, AV_LOG_WARNING, "Audio track %d failed", (int)(i + 1));
+                    }
+                }
+            }
+            //
             // Grab Video Buffer
             //
             if (isHasVideo())
@@ -694,7 +1319,8 @@ FFmpegLibAvStreamImpl::run()
                 {
                     if (m_video_buffer.isBufferFull() == false)
                     {
-                        if (m_useRibbonTimeStrategy == true)
+                        // Offline rendering requires every frame
+                        if (m_useRibbonTimeStrategy == true || m_offline == true)
                         {
                             drop_frame_nb = 0;
                         }
@@ -712,7 +1338,15 @@ FFmpegLibAvStreamImpl::run()
                         }
                         m_video_buffer.writeFrame (videoWriteFlag, drop_frame_nb);
 
+                        if (m_offline)
+                        {
+                            ScopedLock  frameLock (m_frameMutex);
+
+                            m_frameWritten.broadcast();
+                        }
                         videoGrabbingInProcess = true;
+                        if (m_loopWrapped == false && m_video_buffer.loopGeneration() > 0)
+                            m_loopWrapped = true;
                     }
                 }
                 else
@@ -721,8 +1355,17 @@ FFmpegLibAvStreamImpl::run()
                 }
             }
             if (isPlaybackStarted && isPlaybackFinished())
-            {
                 break;
+            //
+            // Audio-only playback does not wait for the full buffer: decoding is much faster than playback
+            //
+            if (isPlaybackStarted == false &&
+                m_prefillOnly == false &&
+                isHasVideo() == false &&
+                audioGrabbingInProcess == true)
+            {
+                isPlaybackStarted = true;
+                startPlayback();
             }
             //
             // If grabbings do not work(waste a time):
@@ -733,7 +1376,7 @@ FFmpegLibAvStreamImpl::run()
             if (audioGrabbingInProcess == false &&
                 videoGrabbingInProcess == false)
             {
-                if (isPlaybackStarted == false)
+                if (isPlaybackStarted == false && m_prefillOnly == false)
                 {
                     isPlaybackStarted = true;
                     startPlayback();
@@ -755,6 +1398,8 @@ FFmpegLibAvStreamImpl::run()
 
     if (pAudioData)
         delete []pAudioData;
+    if (pExtraAudioData)
+        delete []pExtraAudioData;
 
     m_shadowThreadStop = true;
 
@@ -19,17 +19,20 @@
 
 #include <OpenThreads/Thread>
 #include <OpenThreads/Condition>
+#include <vector>
 
 #include "FFmpegILibAvStreamImpl.hpp"
 #include "AudioBuffer.hpp"
+#include "AudioDriftCompensator.hpp"
 #include "VideoVectorBuffer.hpp"
 #include "FFmpegTimer.hpp"
+#include "FFmpegIClock.hpp"
 #include "FFmpegRenderThread.hpp"
 
 
 namespace osgFFmpeg {
 
-class FFmpegLibAvStreamImpl : public FFmpegILibAvStreamImpl, protected OpenThreads::Thread
+class FFmpegLibAvStreamImpl : public FFmpegILibAvStreamImpl, public VideoMemoryListener, protected OpenThreads::Thread
 {
 private:
     typedef OpenThreads::Mutex              Mutex;
@@ -53,6 +56,22 @@ private:
     unsigned long                   m_ellapsedAudioMicroSecOffsetInitial;
     unsigned long                   m_audioDelayMicroSec;
     volatile bool                   m_audio_buffering_finished;
+    unsigned long long              m_audioLoopBytes; // Bytes of the main audio grabbed since the last wrap of the loop
+    AudioDriftCompensator           m_driftCompensator;
+    //
+    // Extra audio track is decoded from the same demuxer, but played by own sink.
+    // Only the main track drives the playback time.
+    //
+    struct ExtraAudioTrack
+    {
+        long                            Index;
+        AudioFormat                     Format;
+        AudioBuffer                     Buffer;
+        osg::ref_ptr<osg::AudioSink>    Sink;
+        unsigned int                    BlockSize;
+        volatile bool                   BufferingFinished;
+    };
+    std::vector<ExtraAudioTrack *>  m_extraAudio;
     //
     long                            m_videoIndex;
     VideoVectorBuffer               m_video_buffer;
@@ -61,13 +80,43 @@ private:
     bool                            m_useRibbonTimeStrategy;
     //
     FFmpegTimer                     m_playerTimer;
+    osg::ref_ptr<FFmpegIClock>      m_clock; // External clock replaces own timer and audio clock. Guarded by \m_mutex
+    double                          m_playbackRate;
+    const double                    m_keyFramesOnlyRate; // Starting from this absolute playback rate, only key-frames are decoded
     bool                            m_isNeedFlushBuffers;
+    bool                            m_isNeedRefillVideo; // Buffered frames have been dropped by memory quota during pause
+    Mutex                           m_quotaMutex;
+    volatile bool                   m_isQuotaChanged; // Quota has been changed by other players, and should be applied by running thread
+    bool                            m_audioOnly; // Player has no control thread, so this thread handles end of playback itself
+    bool                            m_offline; // Frames are rendered by RenderFrame() without pacing, audio is not played. Player has no control thread
+    Mutex                           m_frameMutex;
+    Condition                       m_frameWritten; // Offline rendering waits for grabbed frames
+    unsigned long                   m_durationMS;
+    volatile bool                   m_loopWrapped; // Grabbing has been wrapped to the start without flushing, so playback clock may exceed duration
     FFmpegPlayer *                  m_pPlayer;
     volatile bool                   m_shadowThreadStop;
+    volatile bool                   m_prefillOnly; // Thread fills buffers, but does not start playback
     const bool                      isPlaybackFinished();
+    // Audio is played(and drives the playback time) only with normal playback rate
+    const bool                      isAudioActive() const;
     const bool                      detectIsItImplementedAudioVolume();
+    void                            applyAudioVolume(void * buffer, const unsigned long bytesNb, const AudioFormat & format) const;
+    // Returns number of bytes written to [buffer], ZERO if track finished, or negative value if failed
+    const int                       grabAudio(const long audioIndex, const AudioFormat & format, AudioBuffer & buffer, const unsigned int maxBytes, unsigned char * pAudioData, const double & max_avail_time_micros);
     void                            preRun();
+    // Resize video buffer by its quota. Should be called under \m_quotaMutex, when grabbing and rendering are stopped
+    const bool                      applyMemoryQuota();
+    // Grab frame of the clock time into the resized buffer by accurate seek
+    void                            refillVideo(const unsigned long & elapsedTimeMS);
     void                            startPlayback();
+    // Move audio to ZERO-time point from the grabbing thread
+    void                            rewindAudio();
+    // Forward looping is gapless: grabbing continues from the start without stopping of the threads
+    const bool                      isGaplessLoop() const;
+    // Convert time of the playback clock to time of the file
+    const unsigned long             wrapLoopTime(const unsigned long & clockTimeMS) const;
+    // Continue the main audio from the start, when it finished. Returns false if it could not be wrapped
+    const bool                      loopAudio();
     virtual void                    run ();
     void                            postRun();
     void                            stopShadowThread();
@@ -77,15 +126,21 @@ public:
     virtual                         ~FFmpegLibAvStreamImpl();
 
     virtual void                    setAudioSink(osg::AudioSink * audio_sink);
+    virtual void                    setExtraAudioSink(const size_t trackNb, osg::AudioSink * audio_sink);
     virtual void                    setAudioDelayMicroSec (const double & audioDelayMicroSec);
     virtual const int               initialize(const FFmpegFileHolder * pHolder, FFmpegPlayer * pPlayer);
     virtual void                    loop(const bool loop);
     virtual const bool              loop() const;
 
     virtual void                    Start();
+    virtual void                    Prefill();
     virtual void                    Pause();
     virtual void                    Stop();
     virtual void                    Seek(const unsigned long & newTimeMS);
+    virtual void                    setPlaybackRate(const double & rate);
+    virtual const double            getPlaybackRate() const;
+    virtual const int               Step(const int direction);
+    virtual void                    setVisible(const bool visible);
 
     virtual const bool              isHasAudio() const;
     virtual void                    setAudioVolume(const float &);
@@ -94,7 +149,10 @@ public:
     virtual const float             getAudioBalance() const;
     virtual void                    setAudioBalance(const float & balance);
     virtual void                    GetAudio(void * buffer, int bytesLength);
+    virtual void                    GetExtraAudio(const size_t trackNb, void * buffer, int bytesLength);
     virtual const unsigned long     GetPlaybackTime() const;
+    virtual const unsigned long     GetClockTime() const;
+    virtual void                    setClock(FFmpegIClock * clock);
     //
     /*
      * DO NOT FORGET CALL ReleaseFoundFrame() AFTER GetFramePtr() CALLED AND PTR HAS BEEN USED.
@@ -102,8 +160,11 @@ public:
      */
     virtual int                     GetFramePtr(const unsigned long & timePosMS, unsigned char *& pArray);
     virtual void                    ReleaseFoundFrame();
+    virtual const int               RenderFrame(const unsigned long & timePosMS);
     virtual const bool              isHasVideo() const;
     virtual float                   fps() const;
+
+    virtual void                    onFrameQuotaChanged();
 };
 
 } // namespace osgFFmpeg
@@ -0,0 +1,121 @@
+/* Improved ffmpeg plugin for OpenSceneGraph -
+ * Copyright (C) 2014-2015 Digitalis Education Solutions, Inc. (http://DigitalisEducation.com)
+ * File author: Oktay Radzhabov (oradzhabov at jazzros dot com)
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+#include "FFmpegMappedFile.hpp"
+#include <algorithm>
+
+#if !defined(_WIN32)
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+namespace osgFFmpeg
+{
+
+namespace
+{
+// Pages ahead of the read position, which kernel is asked to read
+const int64_t   ReadAheadBytes  = 4 * 1024 * 1024;
+}
+
+FFmpegMappedFile::Mutex     FFmpegMappedFile::s_mutex;
+FFmpegMappedFile::FileMap   FFmpegMappedFile::s_files;
+
+FFmpegMappedFile::FFmpegMappedFile(unsigned char * data, const int64_t & size)
+{
+    m_data = data;
+    m_size = size;
+}
+
+FFmpegMappedFile::~FFmpegMappedFile()
+{
+#if !defined(_WIN32)
+    if (m_data != NULL)
+        munmap((void *)m_data, (size_t)m_size);
+#endif
+}
+
+osg::ref_ptr<FFmpegMappedFile>
+FFmpegMappedFile::acquire(const std::string & filename)
+{
+    ScopedLock                      lock (s_mutex);
+    osg::ref_ptr<FFmpegMappedFile>  file;
+    //
+    // Mapping, which is released by the last reader, could not be locked
+    //
+    FileMap::iterator               it = s_files.find(filename);
+    if (it != s_files.end() && it->second.lock(file))
+        return file;
+
+#if defined(_WIN32)
+    av_log(NULL, AV_LOG_WARNING, "Memory-mapped files are not supported on this platform");
+    return file;
+#else
+    const int           fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return file;
+
+    struct stat         st;
+    if (fstat(fd, & st) != 0 || S_ISREG(st.st_mode) == 0 || st.st_size <= 0)
+    {
+        ::close(fd);
+        return file;
+    }
+    void *              data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // Mapping keeps the file, so descriptor is not needed anymore
+    ::close(fd);
+
+    if (data == MAP_FAILED)
+    {
+        av_log(NULL, AV_LOG_WARNING, "Cannot map file %s", filename.c_str());
+        return file;
+    }
+    madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    file = new FFmpegMappedFile((unsigned char *)data, st.st_size);
+    s_files[filename] = file.get();
+
+    return file;
+#endif
+}
+
+void
+FFmpegMappedFile::willRead(Reader & reader) const
+{
+#if !defined(_WIN32)
+    //
+    // Range is renewed when read position leaves it(seek) or passes its middle(sequential reading)
+    //
+    if (reader.Pos >= reader.HintStart &&
+        (reader.Pos < reader.HintEnd - ReadAheadBytes / 2 || reader.HintEnd == m_size))
+    {
+        return;
+    }
+    static const int64_t    pageSize = sysconf(_SC_PAGESIZE);
+
+    const int64_t           start = reader.Pos - reader.Pos % pageSize;
+    const int64_t           end = std::min(m_size, start + ReadAheadBytes);
+
+    madvise((void *)(m_data + start), (size_t)(end - start), MADV_WILLNEED);
+
+    reader.HintStart = start;
+    reader.HintEnd = end;
+#endif
+}
+
+} // namespace osgFFmpeg
@@ -0,0 +1,58 @@
+/* Improved ffmpeg plugin for OpenSceneGraph -
+ * Copyright (C) 2014-2015 Digitalis Education Solutions, Inc. (http://DigitalisEducation.com)
+ * File author: Oktay Radzhabov (oradzhabov at jazzros dot com)
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+#ifndef HEADER_GUARD_FFMPEG_MAPPEDFILE_H
+#define HEADER_GUARD_FFMPEG_MAPPEDFILE_H
+
+#include "FFmpegMemorySource.hpp"
+#include <osg/observer_ptr>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
+#include <map>
+#include <string>
+
+namespace osgFFmpeg {
+
+//
+// Local file, which is memory-mapped. Reads and seeks of its IO contexts are served
+// from the mapping without system calls. Mapping is shared by all readers of the same file,
+// so several players of the same asset use the same page cache.
+//
+// Kernel is hinted to read pages ahead of the read position of each context.
+//
+class FFmpegMappedFile : public FFmpegMemorySource
+{
+public:
+    // Mapping of the file [filename]. Returns NULL if file could not be mapped
+    static osg::ref_ptr<FFmpegMappedFile>   acquire(const std::string & filename);
+
+protected:
+                                    FFmpegMappedFile(unsigned char * data, const int64_t & size);
+    virtual                         ~FFmpegMappedFile();
+    virtual void                    willRead(Reader & reader) const;
+
+private:
+    typedef OpenThreads::Mutex              Mutex;
+    typedef OpenThreads::ScopedLock<Mutex>  ScopedLock;
+    typedef std::map<std::string, osg::observer_ptr<FFmpegMappedFile> >  FileMap;
+
+    static Mutex                    s_mutex;
+    static FileMap                  s_files;
+};
+
+} // namespace osgFFmpeg
+
+#endif // HEADER_GUARD_FFMPEG_MAPPEDFILE_H
@@ -0,0 +1,232 @@
+/* Improved ffmpeg plugin for OpenSceneGraph -
+ * Copyright (C) 2014-2015 Digitalis Education Solutions, Inc. (http://DigitalisEducation.com)
+ * File author: Oktay Radzhabov (oradzhabov at jazzros dot com)
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+#include "FFmpegMemorySource.hpp"
+#include "FFmpegMappedFile.hpp"
+#include "FFmpegBlockCache.hpp"
+#include "FFmpegParameters.hpp"
+#include <osgDB/FileNameUtils>
+#include <osg/Notify>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+namespace osgFFmpeg
+{
+
+namespace
+{
+// Size of buffer of IO context
+const int       IOBufferSize    = 32768;
+}
+
+FFmpegMemorySource::FFmpegMemorySource()
+:m_data(NULL),
+m_size(0)
+{
+}
+
+FFmpegMemorySource::FFmpegMemorySource(const unsigned char * data, const size_t & size)
+:m_buffer(data, data + size)
+{
+    m_data = m_buffer.empty() ? NULL : & m_buffer[0];
+    m_size = (int64_t)m_buffer.size();
+}
+
+FFmpegMemorySource::FFmpegMemorySource(std::vector<unsigned char> & data)
+{
+    m_buffer.swap(data);
+    m_data = m_buffer.empty() ? NULL : & m_buffer[0];
+    m_size = (int64_t)m_buffer.size();
+}
+
+FFmpegMemorySource::~FFmpegMemorySource()
+{
+}
+
+const unsigned char *
+FFmpegMemorySource::data() const
+{
+    return m_data;
+}
+
+const int64_t
+FFmpegMemorySource::size() const
+{
+    return m_size;
+}
+
+AVIOContext *
+FFmpegMemorySource::openContext(const std::string & filename, FFmpegParameters * parameters)
+{
+    if (parameters == NULL)
+        return NULL;
+
+    if (parameters->getMemorySource() != NULL)
+        return parameters->getMemorySource()->createContext();
+
+    // Devices are read by demuxer only
+    if (filename.compare(0, 5, "/dev/") == 0)
+        return NULL;
+
+    AVDictionaryEntry *     dictEntry = av_dict_get(* parameters->getOptions(), "mmap", NULL, 0);
+    if (dictEntry != NULL && osgDB::containsServerAddress(filename) == false)
+    {
+        const std::string   value(dictEntry->value);
+        if (value == "1" || value == "yes" || value == "true")
+        {
+            osg::ref_ptr<FFmpegMappedFile>  file = FFmpegMappedFile::acquire(filename);
+            if (file.valid())
+            {
+                OSG_INFO << "File " << filename << " is read from memory mapping" << std::endl;
+
+                return file->createContext();
+            }
+        }
+    }
+
+    dictEntry = av_dict_get(* parameters->getOptions(), "shared_cache", NULL, 0);
+    if (dictEntry != NULL)
+    {
+        const double        cacheMB = atof(dictEntry->value);
+        if (cacheMB > 0.0)
+        {
+            osg::ref_ptr<FFmpegBlockCache>  cache = FFmpegBlockCache::acquire(filename,
+                                                        (size_t)(cacheMB * 1024.0 * 1024.0),
+                                                        * parameters->getOptions());
+            if (cache.valid())
+            {
+                OSG_INFO << "File " << filename << " is read through shared cache" << std::endl;
+
+                return cache->createContext();
+            }
+        }
+    }
+
+    return NULL;
+}
+
+AVIOContext *
+FFmpegMemorySource::createContext()
+{
+    if (m_size <= 0)
+        return NULL;
+
+    unsigned char *     buffer = (unsigned char *)av_malloc(IOBufferSize);
+    if (buffer == NULL)
+        return NULL;
+
+    Reader *            reader = new Reader;
+
+    reader->Source = this;
+    reader->Pos = 0;
+    reader->HintStart = 0;
+    reader->HintEnd = 0;
+
+    AVIOContext *       context = avio_alloc_context(buffer, IOBufferSize, 0, reader,
+                                                    & FFmpegMemorySource::read, NULL, & FFmpegMemorySource::seek);
+    if (context == NULL)
+    {
+        av_free(buffer);
+        delete reader;
+    }
+    return context;
+}
+
+void
+FFmpegMemorySource::closeContext(AVIOContext ** context)
+{
+    if (context == NULL || * context == NULL)
+        return;
+
+    Reader *            reader = (Reader *)(* context)->opaque;
+    //
+    // Context could replace its buffer, so the current one is freed
+    //
+    av_free((* context)->buffer);
+#if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(57, 80, 100)
+    avio_context_free(context);
+#else
+    av_free(* context);
+    * context = NULL;
+#endif
+    // Source is released with the last reader
+    delete reader;
+}
+
+void
+FFmpegMemorySource::willRead(Reader & reader) const
+{
+}
+
+int
+FFmpegMemorySource::readAt(Reader & reader, uint8_t * buf, const int bytesNb)
+{
+    willRead(reader);
+    memcpy(buf, m_data + reader.Pos, bytesNb);
+
+    return bytesNb;
+}
+
+int
+FFmpegMemorySource::read(void * opaque, uint8_t * buf, int buf_size)
+{
+    Reader *            reader = (Reader *)opaque;
+    const int64_t       size = reader->Source->m_size;
+
+    if (reader->Pos >= size)
+        return AVERROR_EOF;
+
+    const int           bytesNb = reader->Source->readAt(* reader, buf,
+                                                        (int)std::min<int64_t>(buf_size, size - reader->Pos));
+    if (bytesNb > 0)
+        reader->Pos += bytesNb;
+
+    return bytesNb;
+}
+
+int64_t
+FFmpegMemorySource::seek(void * opaque, int64_t offset, int whence)
+{
+    Reader *            reader = (Reader *)opaque;
+    const int64_t       size = reader->Source->m_size;
+    int64_t             pos;
+
+    switch (whence & ~AVSEEK_FORCE)
+    {
+    case AVSEEK_SIZE:
+        return size;
+    case SEEK_SET:
+        pos = offset;
+        break;
+    case SEEK_CUR:
+        pos = reader->Pos + offset;
+        break;
+    case SEEK_END:
+        pos = size + offset;
+        break;
+    default:
+        return -1;
+    };
+    if (pos < 0 || pos > size)
+        return -1;
+
+    reader->Pos = pos;
+    return pos;
+}
+
+} // namespace osgFFmpeg
@@ -0,0 +1,88 @@
+/* Improved ffmpeg plugin for OpenSceneGraph -
+ * Copyright (C) 2014-2015 Digitalis Education Solutions, Inc. (http://DigitalisEducation.com)
+ * File author: Oktay Radzhabov (oradzhabov at jazzros dot com)
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+#ifndef HEADER_GUARD_FFMPEG_MEMORYSOURCE_H
+#define HEADER_GUARD_FFMPEG_MEMORYSOURCE_H
+
+#include "FFmpegHeaders.hpp"
+#include <osg/Referenced>
+#include <osg/ref_ptr>
+#include <string>
+#include <vector>
+
+namespace osgFFmpeg {
+
+class FFmpegParameters;
+
+//
+// Media bytes in memory, e.g. entry of an archive or asset bundle. Player opens it by
+// FFmpegParameters::setMemorySource(). Each reader of the source(audio and video readers
+// of the player, several players) gets own IO context with own read position, so one source
+// could be shared by all of them.
+//
+class FFmpegMemorySource : public osg::Referenced
+{
+public:
+    // Source keeps own copy of [size] bytes of [data]
+                                    FFmpegMemorySource(const unsigned char * data, const size_t & size);
+    // Source takes content of [data], which becomes empty
+                                    FFmpegMemorySource(std::vector<unsigned char> & data);
+
+    const unsigned char *           data() const;
+    const int64_t                   size() const;
+
+    // IO context for the reader of [filename]: context of the memory source of [parameters],
+    // context of memory-mapped file, if it is requested by option "mmap",
+    // or context of shared block cache, if it is requested by option "shared_cache".
+    // Returns NULL if file should be opened by demuxer.
+    static AVIOContext *            openContext(const std::string & filename, FFmpegParameters * parameters);
+    // IO context, which reads this source from the start. Context keeps the source till closeContext()
+    AVIOContext *                   createContext();
+    // Free context created by openContext() or createContext()
+    static void                     closeContext(AVIOContext ** context);
+
+protected:
+    // Read position of one context
+    struct Reader
+    {
+        osg::ref_ptr<FFmpegMemorySource>    Source;
+        int64_t                     Pos;
+        int64_t                     HintStart;  // range, which is prepared for reading by derived class
+        int64_t                     HintEnd;
+    };
+
+    // Derived class provides memory by \m_data and \m_size, or overrides readAt()
+                                    FFmpegMemorySource();
+    virtual                         ~FFmpegMemorySource();
+    // Called before bytes at the read position of [reader] are copied
+    virtual void                    willRead(Reader & reader) const;
+    // Copies up to [bytesNb] bytes at the read position of [reader], which is inside of the source.
+    // Returns number of copied bytes, or negative AVERROR
+    virtual int                     readAt(Reader & reader, uint8_t * buf, const int bytesNb);
+
+    const unsigned char *           m_data;
+    int64_t                         m_size;
+
+private:
+    static int                      read(void * opaque, uint8_t * buf, int buf_size);
+    static int64_t                  seek(void * opaque, int64_t offset, int whence);
+
+    std::vector<unsigned char>      m_buffer;
+};
+
+} // namespace osgFFmpeg
+
+#endif // HEADER_GUARD_FFMPEG_MEMORYSOURCE_H
@@ -0,0 +1,248 @@
+/* Improved ffmpeg plugin for OpenSceneGraph -
+ * Copyright (C) 2014-2015 Digitalis Education Solutions, Inc. (http://DigitalisEducation.com)
+ * File author: Oktay Radzhabov (oradzhabov at jazzros dot com)
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+#include "FFmpegPacketPrefetcher.hpp"
+#include <algorithm>
+
+namespace osgFFmpeg
+{
+
+// Failed read of network source is retried after the pause, as the source could recover
+static const unsigned int   MaxReadRetries  = 5;
+static const unsigned long  RetryDelayMS    = 200;
+
+FFmpegPacketPrefetcher::FFmpegPacketPrefetcher(AVFormatContext * fmt_ctx,
+                                               const std::vector<int> & streams,
+                                               const size_t & maxBytes,
+                                               const double & maxDurationMS)
+:m_fmt_ctx_ptr(fmt_ctx),
+m_streams(streams),
+m_maxBytes(maxBytes),
+m_maxDurationMS(maxDurationMS),
+m_bytes(0),
+m_lastTime(0.0),
+m_readResult(0),
+m_isEof(false),
+m_failedReads(0),
+m_underruns(0),
+m_stop(true)
+{
+}
+
+FFmpegPacketPrefetcher::~FFmpegPacketPrefetcher()
+{
+    Stop();
+    clear();
+}
+
+void
+FFmpegPacketPrefetcher::Start()
+{
+    if (isRunning())
+        return;
+
+    m_stop = false;
+    start();
+}
+
+void
+FFmpegPacketPrefetcher::Stop()
+{
+    {
+        ScopedLock  lock (m_mutex);
+
+        m_stop = true;
+        m_cond.broadcast();
+    }
+    if (isRunning())
+        join();
+}
+
+void
+FFmpegPacketPrefetcher::run()
+{
+    while (true)
+    {
+        {
+            ScopedLock  lock (m_mutex);
+
+            while (m_stop == false && (m_readResult < 0 || isFull()))
+                m_cond.wait(& m_mutex);
+            // Seek and Stop() wake the thread, so retry starts from the new position or is cancelled
+            if (m_stop == false && m_failedReads > 0)
+                m_cond.wait(& m_mutex, RetryDelayMS);
+
+            if (m_stop)
+                break;
+        }
+        //
+        // Demuxer is read out of the queue lock, so consumer takes queued packets during I/O stall.
+        // Seek waits for the read, so packet of previous position is never queued after the seek.
+        //
+        ScopedLock  ioLock (m_ioMutex);
+        AVPacket    packet;
+
+        av_init_packet(& packet);
+        packet.data = NULL;
+        packet.size = 0;
+
+        const int   rez = av_read_frame(m_fmt_ctx_ptr, & packet);
+
+        if (rez >= 0 && (m_stop || isWanted(packet.stream_index) == false || av_dup_packet(& packet) < 0))
+        {
+            av_free_packet(& packet);
+            continue;
+        }
+        // Read aborted by interrupt callback is not an error of the source
+        if (m_stop)
+            break;
+
+        ScopedLock  lock (m_mutex);
+
+        if (rez < 0)
+        {
+            const bool  isEof = (rez == static_cast<int>(AVERROR_EOF) || (m_fmt_ctx_ptr->pb && m_fmt_ctx_ptr->pb->eof_reached));
+
+            if (isEof == false && ++m_failedReads <= MaxReadRetries)
+            {
+                av_log(NULL, AV_LOG_WARNING, "Prefetcher failed to read packet, retry %u of %u", m_failedReads, MaxReadRetries);
+                continue;
+            }
+            // Queued packets are consumed first, then readers get the error
+            m_readResult = rez;
+            m_isEof = isEof;
+            m_failedReads = 0;
+        }
+        else
+        {
+            Entry   entry;
+
+            m_failedReads = 0;
+
+            if (packet.dts != AV_NOPTS_VALUE)
+                m_lastTime = packet.dts * av_q2d(m_fmt_ctx_ptr->streams[packet.stream_index]->time_base);
+
+            entry.Packet = packet;
+            entry.Time = m_lastTime;
+            m_queue.push_back(entry);
+            m_bytes += packet.size;
+        }
+        m_cond.broadcast();
+    }
+}
+
+const int
+FFmpegPacketPrefetcher::readFrame(AVPacket * packet)
+{
+    ScopedLock  lock (m_mutex);
+
+    if (m_queue.empty() && m_readResult >= 0)
+    {
+        ++m_underruns;
+
+        while (m_queue.empty() && m_readResult >= 0 && m_stop == false)
+            m_cond.wait(& m_mutex);
+    }
+    if (m_queue.empty())
+        return (m_readResult < 0) ? m_readResult : static_cast<int>(AVERROR_EOF);
+
+    * packet = m_queue.front().Packet;
+    m_bytes -= packet->size;
+    m_queue.pop_front();
+    // I/O thread could wait for free space
+    m_cond.broadcast();
+
+    return 0;
+}
+
+const int
+FFmpegPacketPrefetcher::seekFrame(const int streamIndex, const int64_t & timestamp, const int flags)
+{
+    ScopedLock  ioLock (m_ioMutex);
+    ScopedLock  lock (m_mutex);
+
+    clear();
+    m_readResult = 0;
+    m_isEof = false;
+    m_failedReads = 0;
+    m_cond.broadcast();
+
+    return av_seek_frame(m_fmt_ctx_ptr, streamIndex, timestamp, flags);
+}
+
+const FFmpegPacketPrefetcher::Stats
+FFmpegPacketPrefetcher::getStats() const
+{
+    ScopedLock  lock (m_mutex);
+    Stats       stats;
+
+    stats.Packets = m_queue.size();
+    stats.Bytes = m_bytes;
+    stats.DurationMS = durationMS();
+    stats.Underruns = m_underruns;
+
+    return stats;
+}
+
+const bool
+FFmpegPacketPrefetcher::isEndOfFile() const
+{
+    ScopedLock  lock (m_mutex);
+
+    return m_isEof;
+}
+
+int
+FFmpegPacketPrefetcher::interruptCallback(void * opaque)
+{
+    const FFmpegPacketPrefetcher *  prefetcher = * static_cast<FFmpegPacketPrefetcher **>(opaque);
+
+    return (prefetcher != NULL && prefetcher->m_stop) ? 1 : 0;
+}
+
+const bool
+FFmpegPacketPrefetcher::isWanted(const int streamIndex) const
+{
+    return m_streams.empty() || std::find(m_streams.begin(), m_streams.end(), streamIndex) != m_streams.end();
+}
+
+const bool
+FFmpegPacketPrefetcher::isFull() const
+{
+    return m_bytes >= m_maxBytes || durationMS() >= m_maxDurationMS;
+}
+
+const double
+FFmpegPacketPrefetcher::durationMS() const
+{
+    if (m_queue.empty())
+        return 0.0;
+
+    return std::max(0.0, (m_queue.back().Time - m_queue.front().Time) * 1000.0);
+}
+
+void
+FFmpegPacketPrefetcher::clear()
+{
+    while (m_queue.empty() == false)
+    {
+        av_free_packet(& m_queue.front().Packet);
+        m_queue.pop_front();
+    }
+    m_bytes = 0;
+}
+
+} // namespace osgFFmpeg
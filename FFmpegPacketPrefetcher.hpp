@@ -0,0 +1,110 @@
+/* Improved ffmpeg plugin for OpenSceneGraph -
+ * Copyright (C) 2014-2015 Digitalis Education Solutions, Inc. (http://DigitalisEducation.com)
+ * File author: Oktay Radzhabov (oradzhabov at jazzros dot com)
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+#ifndef HEADER_GUARD_FFMPEG_PACKETPREFETCHER_H
+#define HEADER_GUARD_FFMPEG_PACKETPREFETCHER_H
+
+#include "FFmpegHeaders.hpp"
+#include <OpenThreads/Thread>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/Condition>
+#include <OpenThreads/ScopedLock>
+#include <deque>
+#include <vector>
+
+namespace osgFFmpeg {
+
+//
+// Reads packets of the demuxer ahead by own I/O thread, so stalls of network sources
+// are absorbed by the queue and do not reach decoders. Queue is limited by size in bytes
+// and by duration of the queued packets.
+//
+// While prefetcher runs, demuxer should be read and seeked only through it.
+// I/O thread writes context of the demuxer, so end of file is taken from isEndOfFile().
+//
+class FFmpegPacketPrefetcher : protected OpenThreads::Thread
+{
+public:
+    struct Stats
+    {
+        size_t                  Packets;
+        size_t                  Bytes;
+        double                  DurationMS;
+        unsigned long           Underruns;  // number of reads, which waited for the I/O thread
+
+        Stats():Packets(0),Bytes(0),DurationMS(0.0),Underruns(0){}
+    };
+
+                                FFmpegPacketPrefetcher(AVFormatContext * fmt_ctx,
+                                        const std::vector<int> & streams,
+                                        const size_t & maxBytes,
+                                        const double & maxDurationMS);
+    virtual                     ~FFmpegPacketPrefetcher();
+
+    void                        Start();
+    void                        Stop();
+    // Parameters and returned values are as av_read_frame() and av_seek_frame() have
+    const int                   readFrame(AVPacket * packet);
+    const int                   seekFrame(const int streamIndex, const int64_t & timestamp, const int flags);
+
+    const Stats                 getStats() const;
+    // True if the last read of I/O thread reached end of file
+    const bool                  isEndOfFile() const;
+
+    //
+    // Interrupt callback of demuxer. \opaque points to pointer of the prefetcher, which is NULL
+    // while demuxer is read directly. Demuxer copies the callback to I/O context on opening,
+    // so it is installed before avformat_open_input() and aborts blocking read on Stop().
+    //
+    static int                  interruptCallback(void * opaque);
+
+private:
+    typedef OpenThreads::Mutex              Mutex;
+    typedef OpenThreads::ScopedLock<Mutex>  ScopedLock;
+
+    struct Entry
+    {
+        AVPacket                Packet;
+        double                  Time;   // in seconds
+    };
+
+    virtual void                run();
+    const bool                  isWanted(const int streamIndex) const;
+    const bool                  isFull() const;
+    const double                durationMS() const;
+    void                        clear();
+
+    AVFormatContext *           m_fmt_ctx_ptr;
+    const std::vector<int>      m_streams;          // streams, packets of which are queued. All if empty
+    const size_t                m_maxBytes;
+    const double                m_maxDurationMS;
+
+    Mutex                       m_ioMutex;          // locked while demuxer is used by any thread
+    mutable Mutex               m_mutex;            // guards the queue
+    OpenThreads::Condition      m_cond;
+    std::deque<Entry>           m_queue;
+    size_t                      m_bytes;
+    double                      m_lastTime;
+    int                         m_readResult;       // negative result of the last read, which finishes the queue
+    bool                        m_isEof;            // \m_readResult is caused by end of file
+    unsigned int                m_failedReads;      // reads failed in a row. Read is retried till the limit, then error is reported
+    unsigned long               m_underruns;
+    volatile bool               m_stop;
+};
+
+} // namespace osgFFmpeg
+
+#endif // HEADER_GUARD_FFMPEG_PACKETPREFETCHER_H
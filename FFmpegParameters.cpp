@@ -58,6 +58,15 @@ FFmpegParameters::FFmpegParameters() :
     av_dict_set(&m_options, "foo", "bar", 0);
 }
 
+FFmpegParameters::FFmpegParameters(const FFmpegParameters & other) :
+    osg::Referenced(),
+    m_format(other.m_format),
+    m_context(0),
+    m_options(0)
+{
+    av_dict_copy(&m_options, other.m_options, 0);
+}
+
 FFmpegParameters::~FFmpegParameters()
 {
     av_dict_free(&m_options);
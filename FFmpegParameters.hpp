@@ -20,6 +20,7 @@
 #define HEADER_GUARD_OSGFFMPEG_FFMPEG_PARAMETERS_H
 
 #include "FFmpegHeaders.hpp"
+#include "FFmpegMemorySource.hpp"
 
 #include <osg/Notify>
 
@@ -34,14 +35,20 @@ class FFmpegParameters : public osg::Referenced
 public:
 
     FFmpegParameters();
+    // Copies format and options, which are consumed by opening of the file. Custom IO context and memory source are not shared.
+    FFmpegParameters(const FFmpegParameters & other);
     ~FFmpegParameters();
 
     bool isFormatAvailable() const { return m_format!=NULL; }
     
     AVInputFormat* getFormat() { return m_format; }
     AVDictionary** getOptions() { return &m_options; }
+    // Custom IO context is owned by caller, and it is used by both audio and video readers
     void setContext(AVIOContext* context) { m_context = context; }
     AVIOContext* getContext() { return m_context; }
+    // Media is read from memory instead of the file. Each reader gets own IO context of the source
+    void setMemorySource(FFmpegMemorySource* source) { m_memorySource = source; }
+    FFmpegMemorySource* getMemorySource() { return m_memorySource.get(); }
     
     void parse(const std::string& name, const std::string& value);
 
@@ -49,6 +56,7 @@ protected:
 
     AVInputFormat* m_format;
     AVIOContext* m_context;
+    osg::ref_ptr<FFmpegMemorySource> m_memorySource;
     AVDictionary* m_options;
 };
 
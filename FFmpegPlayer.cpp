@@ -20,6 +20,8 @@
 
 #include <OpenThreads/ScopedLock>
 #include <osg/Notify>
+#include <osg/NodeVisitor>
+#include <osg/FrameStamp>
 
 #include <memory>
 
@@ -27,8 +29,19 @@ size_t getMemorySize();
 
 namespace osgFFmpeg {
 
+namespace
+{
+// Reference time, which moves back more than one frame or forward more than this, is treated as jump
+const double    ReferenceJumpMS = 2000.0;
+}
+
 FFmpegPlayer::FFmpegPlayer() :
-    m_commands(0)
+    m_commands(0),
+    m_audioOnly(false),
+    m_offline(false),
+    m_prefilling(false),
+    m_playback_rate(1.0),
+    m_simulationClock(false)
 {
     setOrigin(osg::Image::TOP_LEFT);
 
@@ -40,7 +53,11 @@ FFmpegPlayer::FFmpegPlayer() :
 
 
 FFmpegPlayer::FFmpegPlayer(const FFmpegPlayer & image, const osg::CopyOp & copyop) :
-    osg::ImageStream(image, copyop)
+    osg::ImageStream(image, copyop),
+    m_audioOnly(false),
+    m_offline(false),
+    m_prefilling(false),
+    m_simulationClock(false)
 {
     // todo: probably incorrect or incomplete
 }
@@ -73,6 +90,9 @@ bool FFmpegPlayer::open(const std::string & filename, FFmpegParameters* paramete
     if (m_fileHolder.open(filename, parameters) < 0)
         return false;
 
+    AVDictionaryEntry *     dictEntry = parameters ? av_dict_get(* parameters->getOptions(), "reference_clock", NULL, 0) : NULL;
+    m_simulationClock = (dictEntry != NULL && std::string(dictEntry->value) == "simulation");
+
     if (m_streamer.open(& m_fileHolder, this) < 0)
     {
         m_fileHolder.close();
@@ -105,19 +125,32 @@ bool FFmpegPlayer::open(const std::string & filename, FFmpegParameters* paramete
         OSG_NOTICE<<"Attaching FFmpegAudioStream"<<std::endl;
 
         getAudioStreams().push_back(new FFmpegAudioStream(& m_fileHolder, & m_streamer));
+        //
+        // Extra audio tracks are attached after the main one
+        //
+        for (size_t i = 0; i < m_fileHolder.extraAudioNb(); ++i)
+            getAudioStreams().push_back(new FFmpegAudioStream(& m_fileHolder, & m_streamer, i + 1));
     }
 
     _status = PAUSED;
     applyLoopingMode();
-
-    start(); // start thread
+    //
+    // Audio cues are opened often, so audio-only player does not start the control thread.
+    // Its commands are short: they just start or stop the grabbing thread.
+    // Offline player handles commands in the caller's thread, so rendering follows them at once.
+    //
+    m_audioOnly = m_fileHolder.isAudioOnly();
+    m_offline = m_fileHolder.isOffline();
+    if (m_audioOnly == false && m_offline == false)
+        start(); // start thread
 
     return true;
 }
 
 void FFmpegPlayer::close()
 {
-    m_streamer.setAudioSink(NULL);
+    for (size_t i = 0; i <= m_fileHolder.extraAudioNb(); ++i)
+        m_streamer.setAudioSink(i, NULL);
     m_streamer.close();
     m_fileHolder.close();
 }
@@ -168,6 +201,120 @@ void FFmpegPlayer::quit(bool waitForThreadToExit)
         if (waitForThreadToExit)
             join();
     }
+    else if (m_audioOnly || m_offline)
+    {
+        ScopedLock  lock(m_commandMutex);
+
+        cmdPause();
+        close();
+        m_audioOnly = false;
+        m_offline = false;
+    }
+}
+
+void FFmpegPlayer::setPlaybackRate(double rate)
+{
+    const double minRate = 0.25;
+    const double maxRate = 16.0;
+    const double sign = (rate < 0.0) ? -1.0 : 1.0;
+
+    m_playback_rate = sign * std::min(maxRate, std::max(minRate, fabs(rate)));
+    pushCommand(CMD_SET_RATE);
+}
+
+double FFmpegPlayer::getPlaybackRate() const
+{
+    return m_playback_rate;
+}
+
+void FFmpegPlayer::setTimeMultiplier(double multiplier)
+{
+    setPlaybackRate(multiplier);
+}
+
+double FFmpegPlayer::getTimeMultiplier() const
+{
+    return getPlaybackRate();
+}
+
+void FFmpegPlayer::prefill()
+{
+    pushCommand(CMD_PREFILL);
+}
+
+void FFmpegPlayer::stepForward()
+{
+    pushCommand(CMD_STEP_FORWARD);
+}
+
+void FFmpegPlayer::stepBackward()
+{
+    pushCommand(CMD_STEP_BACKWARD);
+}
+
+void FFmpegPlayer::setVisible(bool visible)
+{
+    m_streamer.setVisible(visible);
+}
+
+void FFmpegPlayer::setClock(FFmpegIClock * clock)
+{
+    if (clock != m_referenceClock.get())
+        m_referenceClock = NULL;
+
+    m_streamer.setClock(clock);
+}
+
+void FFmpegPlayer::setReferenceTime(double time)
+{
+    const double        timeMS = std::max(0.0, time * 1000.0);
+    bool                jump = false;
+
+    if (m_referenceClock.valid() == false)
+    {
+        m_referenceClock = new FFmpegExternalClock;
+        m_streamer.setClock(m_referenceClock.get());
+        jump = true;
+    }
+    else
+    {
+        const double    prevTimeMS = m_referenceClock->GetClockTime();
+        const double    frameMS = 1000.0 / std::max(1.0, getFrameRate());
+
+        jump = (timeMS < prevTimeMS - frameMS || timeMS > prevTimeMS + ReferenceJumpMS);
+    }
+    m_referenceClock->setClockTime((unsigned long)timeMS);
+    //
+    // Buffered frames do not cover new time, so decoding restarts from there
+    //
+    if (jump)
+    {
+        const bool      playing = (_status == PLAYING);
+
+        seek(timeMS);
+        if (playing)
+            play();
+    }
+    //
+    // Offline commands are handled already, so the frame is waited here
+    //
+    if (m_offline)
+    {
+        ScopedLock  lock(m_commandMutex);
+
+        m_streamer.renderFrame((unsigned long)timeMS);
+    }
+}
+
+bool FFmpegPlayer::requiresUpdateCall() const
+{
+    return m_simulationClock;
+}
+
+void FFmpegPlayer::update(osg::NodeVisitor * nv)
+{
+    if (m_simulationClock && nv != NULL && nv->getFrameStamp() != NULL)
+        setReferenceTime(nv->getFrameStamp()->getSimulationTime());
 }
 
 void FFmpegPlayer::setVolume(float volume)
@@ -221,6 +368,12 @@ double FFmpegPlayer::getFrameRate() const
 }
 
 
+void FFmpegPlayer::getPrefetchStats(FFmpegPacketPrefetcher::Stats & videoStats, FFmpegPacketPrefetcher::Stats & audioStats) const
+{
+    m_fileHolder.getPrefetchStats(videoStats, audioStats);
+}
+
+
 
 bool FFmpegPlayer::isImageTranslucent() const
 {
@@ -229,6 +382,14 @@ bool FFmpegPlayer::isImageTranslucent() const
 
 
 
+void FFmpegPlayer::playbackFinished()
+{
+    // Streaming thread is finishing, so here is nothing to stop
+    _status = PAUSED;
+}
+
+
+
 void FFmpegPlayer::run()
 {
     try
@@ -289,6 +450,13 @@ void FFmpegPlayer::applyLoopingMode()
 
 void FFmpegPlayer::pushCommand(Command cmd)
 {
+    if (m_audioOnly || m_offline)
+    {
+        ScopedLock  lock(m_commandMutex);
+
+        handleCommand(cmd);
+        return;
+    }
     m_commands->push(cmd);
     m_commandQueue_cond.signal();
 }
@@ -313,6 +481,22 @@ bool FFmpegPlayer::handleCommand(const Command cmd)
         cmdSeek(m_seek_time);
         return true;
 
+    case CMD_SET_RATE:
+        cmdSetPlaybackRate(m_playback_rate);
+        return true;
+
+    case CMD_STEP_FORWARD:
+        cmdStep(1);
+        return true;
+
+    case CMD_STEP_BACKWARD:
+        cmdStep(-1);
+        return true;
+
+    case CMD_PREFILL:
+        cmdPrefill();
+        return true;
+
     case CMD_STOP:
         cmdPause();
         return false;
@@ -331,18 +515,20 @@ void FFmpegPlayer::cmdPlay()
         m_streamer.play();
 
     _status = PLAYING;
+    m_prefilling = false;
 }
 
 
 
 void FFmpegPlayer::cmdPause()
 {
-    if (_status == PLAYING)
+    if (_status == PLAYING || m_prefilling)
     {
         m_streamer.pause();
     }
 
     _status = PAUSED;
+    m_prefilling = false;
 }
 
 
@@ -373,4 +559,54 @@ void FFmpegPlayer::cmdSeek(double time)
     m_streamer.seek(ul_time);
 }
 
+void FFmpegPlayer::cmdSetPlaybackRate(double rate)
+{
+    bool isPlayed = false;
+
+    if (_status == PLAYING)
+    {
+        isPlayed = true;
+        m_streamer.pause();
+    }
+
+    m_streamer.setPlaybackRate(rate);
+
+    if (isPlayed == true)
+        m_streamer.play();
+}
+
+void FFmpegPlayer::cmdStep(int direction)
+{
+    cmdPause();
+
+    if (m_fileHolder.videoIndex() < 0)
+        return;
+
+    if (m_streamer.step(direction) < 0)
+    {
+        OSG_INFO << "FFmpegPlayer::cmdStep() No more frames in this direction" << std::endl;
+        return;
+    }
+    //
+    // Render thread is stopped, so stepped frame is published here
+    //
+    GLint                   internalTexFmt;
+    GLint                   pixFmt;
+    FFmpegFileHolder::getGLPixFormats (m_fileHolder.getPixFormat(), internalTexFmt, pixFmt);
+
+    setImage(
+        m_fileHolder.width(), m_fileHolder.height(), 1, internalTexFmt, pixFmt, GL_UNSIGNED_BYTE,
+        const_cast<unsigned char *>(m_streamer.getFrame()), NO_DELETE
+    );
+}
+
+void FFmpegPlayer::cmdPrefill()
+{
+    if (_status != PAUSED)
+        return;
+
+    m_streamer.prefill();
+    m_prefilling = true;
+}
+
 } // namespace osgFFmpeg
@@ -23,11 +23,12 @@
 #include "MessageQueue.hpp"
 #include "FFmpegFileHolder.hpp"
 #include "FFmpegStreamer.hpp"
+#include "FFmpegExternalClock.hpp"
 
 namespace osgFFmpeg {
 
 // This parameter should be incremented each time before commit to repository
-#define OSG_FFMPEG_PLUGIN_RELEASE_VERSION_INT   11
+#define OSG_FFMPEG_PLUGIN_RELEASE_VERSION_INT   56
 
 
 template <class T>
@@ -53,6 +54,36 @@ public:
     virtual void                seek(double time);
     virtual void                quit(bool waitForThreadToExit = true);
 
+    // Trick-play. Absolute value of the rate is limited by range [0.25 .. 16],
+    // negative value means reverse playback. Audio is muted when rate differs from 1.0.
+    void                        setPlaybackRate(double rate);
+    double                      getPlaybackRate() const;
+    virtual void                setTimeMultiplier(double multiplier);
+    virtual double              getTimeMultiplier() const;
+
+    // Decode first frames and audio of paused player in background, so next play() starts without delay
+    void                        prefill();
+
+    // Pause playback and show exactly next/previous frame
+    void                        stepForward();
+    void                        stepBackward();
+
+    // Hint for the process-wide budget of decoded frames memory:
+    // invisible players keep less frames than visible ones. By default player is visible.
+    void                        setVisible(bool visible);
+
+    // Frames are selected by time of external [clock], e.g. of FFmpegSyncGroup, instead of own timer
+    // or played audio. NULL restores own clock
+    void                        setClock(FFmpegIClock * clock);
+    // Frames of playing player are selected by [time] in seconds, given by the application since the first call,
+    // e.g. simulation time of the frame. Jump of the time makes the player to seek.
+    // With option "reference_clock" = "simulation" time is taken from frame stamp of update traversal.
+    // With option "offline" the call returns, when exactly the frame of [time] is decoded and set as the image.
+    virtual void                setReferenceTime(double time);
+
+    virtual bool                requiresUpdateCall() const;
+    virtual void                update(osg::NodeVisitor * nv);
+
     virtual void                setVolume(float volume);
     virtual float               getVolume() const;
 
@@ -68,6 +99,13 @@ public:
 
     virtual bool                isImageTranslucent() const;
 
+    // Depth of the queues of packets, read ahead from network source(see option "prefetch_duration")
+    void                        getPrefetchStats(FFmpegPacketPrefetcher::Stats & videoStats,
+                                        FFmpegPacketPrefetcher::Stats & audioStats) const;
+
+    // Called by streaming thread of audio-only player, which has no control thread
+    void                        playbackFinished();
+
 private:
     void                        close();
 
@@ -77,7 +115,11 @@ private:
         CMD_PAUSE,
         CMD_STOP,
         CMD_REWIND,
-        CMD_SEEK
+        CMD_SEEK,
+        CMD_SET_RATE,
+        CMD_STEP_FORWARD,
+        CMD_STEP_BACKWARD,
+        CMD_PREFILL
     };
 
     typedef MessageQueue<Command>   CommandQueue;
@@ -96,13 +138,25 @@ private:
     void                        cmdPause();
     void                        cmdRewind();
     void                        cmdSeek(double time);
+    void                        cmdSetPlaybackRate(double rate);
+    void                        cmdStep(int direction);
+    void                        cmdPrefill();
 
     FFmpegFileHolder            m_fileHolder;
     FFmpegStreamer              m_streamer;
 
     CommandQueue *              m_commands;
     Condition                   m_commandQueue_cond;
+    // Audio-only player has no control thread, its commands are handled in the caller's thread
+    bool                        m_audioOnly;
+    // Offline player renders frames in the caller's thread, so its commands are handled there too
+    bool                        m_offline;
+    Mutex                       m_commandMutex;
+    bool                        m_prefilling; // Streamer fills buffers of paused player
     double                      m_seek_time;
+    double                      m_playback_rate;
+    osg::ref_ptr<FFmpegExternalClock>   m_referenceClock;   // Clock of setReferenceTime()
+    bool                        m_simulationClock;  // Reference time follows simulation time of update traversal
 };
 
 } // namespace osgFFmpeg
@@ -0,0 +1,732 @@
+/* Improved ffmpeg plugin for OpenSceneGraph -
+ * Copyright (C) 2014-2015 Digitalis Education Solutions, Inc. (http://DigitalisEducation.com)
+ * File author: Oktay Radzhabov (oradzhabov at jazzros dot com)
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+#include "FFmpegPlaylistPlayer.hpp"
+
+#include <osg/Notify>
+#include <osg/observer_ptr>
+#include <cstring>
+
+namespace osgFFmpeg {
+
+namespace
+{
+// Period of checking of the current item by playlist thread
+const unsigned int  PollMicroSec    = 5000;
+// Next item starts a bit earlier than the end of current one, to hide the polling period
+const double        SwitchLeadMS    = 10.0;
+// Frame of the previous item could be in use by drawing, so the item is released with delay
+const double        RetireDelaySec  = 1.0;
+}
+
+//
+// Audio stream of the playlist. Its sink pulls main audio of current item
+//
+class FFmpegPlaylistPlayer::AudioStreamProxy : public osg::AudioStream
+{
+public:
+                                    AudioStreamProxy(FFmpegPlaylistPlayer * playlist = NULL) :
+                                        m_playlist(playlist)
+                                    {
+                                    }
+                                    AudioStreamProxy(const AudioStreamProxy & audio, const osg::CopyOp & copyop = osg::CopyOp::SHALLOW_COPY) :
+                                        osg::AudioStream(audio, copyop)
+                                    {
+                                    }
+
+    META_Object(osgFFmpeg, AudioStreamProxy);
+
+    virtual void                    setAudioSink(osg::AudioSink * audio_sink)
+    {
+        osg::ref_ptr<FFmpegPlaylistPlayer>  playlist;
+
+        if (m_playlist.lock(playlist))
+            playlist->setAudioSink(audio_sink);
+    }
+
+    virtual void                    consumeAudioBuffer(void * const buffer, const size_t size)
+    {
+        osg::ref_ptr<osg::AudioStream>  stream = currentStream();
+
+        if (stream.valid())
+            stream->consumeAudioBuffer(buffer, size);
+        else
+            memset(buffer, 0, size);
+    }
+
+    // Sink of the playlist is configured by the first item, so items should have the same audio format
+    virtual int                     audioFrequency() const
+    {
+        osg::ref_ptr<osg::AudioStream>  stream = currentStream();
+
+        return stream.valid() ? stream->audioFrequency() : 0;
+    }
+    virtual int                     audioNbChannels() const
+    {
+        osg::ref_ptr<osg::AudioStream>  stream = currentStream();
+
+        return stream.valid() ? stream->audioNbChannels() : 0;
+    }
+    virtual osg::AudioStream::SampleFormat  audioSampleFormat() const
+    {
+        osg::ref_ptr<osg::AudioStream>  stream = currentStream();
+
+        return stream.valid() ? stream->audioSampleFormat() : osg::AudioStream::SAMPLE_FORMAT_S16;
+    }
+
+private:
+    osg::ref_ptr<osg::AudioStream>  currentStream() const
+    {
+        osg::ref_ptr<FFmpegPlaylistPlayer>  playlist;
+
+        return m_playlist.lock(playlist) ? playlist->currentAudioStream() : NULL;
+    }
+
+    osg::observer_ptr<FFmpegPlaylistPlayer> m_playlist;
+};
+
+//
+// Sink of the item. While the item is current, it controls the sink of the playlist.
+// Item keeps its audio only if it has sink when it starts, so it gets this sink when it is opened.
+//
+class FFmpegPlaylistPlayer::ItemAudioSink : public osg::AudioSink
+{
+public:
+                                    ItemAudioSink(FFmpegPlaylistPlayer * playlist, const FFmpegPlayer * item) :
+                                        m_playlist(playlist),
+                                        m_item(item),
+                                        m_enabled(false)
+                                    {
+                                    }
+
+    // Item initializes attached sink by play() and pause(), which should not affect the playlist
+    void                            enable()
+    {
+        m_enabled = true;
+    }
+
+    virtual void                    play()
+    {
+        osg::ref_ptr<osg::AudioSink>    sink = activeSink();
+
+        if (sink.valid())
+            sink->play();
+    }
+    virtual void                    pause()
+    {
+        osg::ref_ptr<osg::AudioSink>    sink = activeSink();
+
+        if (sink.valid())
+            sink->pause();
+    }
+    // Sink of the playlist plays next items, so it is only paused
+    virtual void                    stop()
+    {
+        pause();
+    }
+    virtual bool                    playing() const
+    {
+        osg::ref_ptr<osg::AudioSink>    sink = activeSink();
+
+        return sink.valid() ? sink->playing() : false;
+    }
+    virtual double                  getDelay() const
+    {
+        osg::ref_ptr<osg::AudioSink>    sink = activeSink();
+
+        return sink.valid() ? sink->getDelay() : 0.0;
+    }
+
+    virtual const char *            libraryName() const { return "osgFFmpeg"; }
+    virtual const char *            className() const { return "ItemAudioSink"; }
+
+private:
+    osg::ref_ptr<osg::AudioSink>    activeSink() const
+    {
+        osg::ref_ptr<FFmpegPlaylistPlayer>  playlist;
+
+        if (m_enabled == false || m_playlist.lock(playlist) == false)
+            return NULL;
+
+        return playlist->activeAudioSink(m_item);
+    }
+
+    osg::observer_ptr<FFmpegPlaylistPlayer> m_playlist;
+    const FFmpegPlayer *                    m_item;
+    volatile bool                           m_enabled;
+};
+
+FFmpegPlaylistPlayer::FFmpegPlaylistPlayer() :
+    m_currentIndex(0),
+    m_currentStarted(false),
+    m_nextIndex(0),
+    m_publishedModifiedCount(0),
+    m_retiredTick(0),
+    m_volume(1.0f),
+    m_stop(false),
+    m_audioItem(NULL)
+{
+    setOrigin(osg::Image::TOP_LEFT);
+}
+
+
+
+FFmpegPlaylistPlayer::FFmpegPlaylistPlayer(const FFmpegPlaylistPlayer & player, const osg::CopyOp & copyop) :
+    osg::ImageStream(player, copyop),
+    m_currentIndex(0),
+    m_currentStarted(false),
+    m_nextIndex(0),
+    m_publishedModifiedCount(0),
+    m_retiredTick(0),
+    m_volume(1.0f),
+    m_stop(false),
+    m_audioItem(NULL)
+{
+    // todo: probably incorrect or incomplete
+}
+
+
+
+FFmpegPlaylistPlayer::~FFmpegPlaylistPlayer()
+{
+    OSG_INFO << "Destructing FFmpegPlaylistPlayer..." << std::endl;
+
+    quit(true);
+
+    getAudioStreams().clear();
+}
+
+bool FFmpegPlaylistPlayer::open(const std::vector<std::string> & filenames, FFmpegParameters* parameters)
+{
+    m_fileNames = filenames;
+    m_parameters = parameters;
+    //
+    // First item is not prefilled: audio sinks are attached to its streams after opening of the playlist
+    //
+    while (m_fileNames.empty() == false)
+    {
+        osg::ref_ptr<FFmpegPlayer>  item = openItem(0, false);
+
+        if (item.valid())
+        {
+            ScopedLock  lock(m_mutex);
+
+            _status = PAUSED;
+            setCurrentItem(item.get(), 0);
+            //
+            // Sink attached to the playlist plays audio of all items
+            //
+            getAudioStreams().clear();
+            if (item->getAudioStreams().empty() == false)
+                getAudioStreams().push_back(new AudioStreamProxy(this));
+
+            return true;
+        }
+    }
+    return false;
+}
+
+void FFmpegPlaylistPlayer::setItemOpenedCallback(ItemOpenedCallback * callback)
+{
+    ScopedLock  lock(m_mutex);
+
+    m_itemOpenedCallback = callback;
+}
+
+void FFmpegPlaylistPlayer::play()
+{
+    ScopedLock  lock(m_mutex);
+
+    _status = PLAYING;
+    if (m_current.valid())
+        m_current->play();
+    //
+    // Next items are opened in background since the first playback
+    //
+    if (isRunning() == false)
+    {
+        m_stop = false;
+        start();
+    }
+}
+
+
+
+void FFmpegPlaylistPlayer::pause()
+{
+    ScopedLock  lock(m_mutex);
+
+    _status = PAUSED;
+    if (m_current.valid())
+        m_current->pause();
+}
+
+
+
+void FFmpegPlaylistPlayer::rewind()
+{
+    osg::ref_ptr<FFmpegPlayer>  item;
+    osg::ref_ptr<FFmpegPlayer>  previous;
+    osg::ref_ptr<FFmpegPlayer>  dropped;
+    {
+        ScopedLock  lock(m_mutex);
+
+        if (m_current.valid() && m_currentIndex == 0)
+        {
+            m_current->rewind();
+            return;
+        }
+        if (m_next.valid() && m_nextIndex == 0)
+        {
+            item = m_next;
+            m_next = NULL;
+        }
+    }
+    while (item.valid() == false)
+    {
+        if (getNumItems() == 0)
+            return;
+
+        item = openItem(0, false);
+    }
+
+    ScopedLock  lock(m_mutex);
+
+    previous = setCurrentItem(item.get(), 0);
+    //
+    // Prepared item is not next one anymore
+    //
+    if (m_next.valid() && m_nextIndex != nextItemIndex())
+    {
+        dropped = m_next;
+        m_next = NULL;
+    }
+}
+
+void FFmpegPlaylistPlayer::seek(double time)
+{
+    ScopedLock  lock(m_mutex);
+
+    if (m_current.valid() == false)
+        return;
+
+    m_current->seek(time);
+    //
+    // Seek pauses the item, which would be taken as its end. So the item is resumed,
+    // and it is not finished till it is seen playing again.
+    //
+    if (_status == PLAYING)
+    {
+        m_currentStarted = false;
+        m_current->play();
+    }
+}
+
+
+
+void FFmpegPlaylistPlayer::quit(bool waitForThreadToExit)
+{
+    m_stop = true;
+    if (isRunning() && waitForThreadToExit)
+        join();
+
+    osg::ref_ptr<FFmpegPlayer>  items[4];
+    {
+        ScopedLock  lock(m_mutex);
+
+        items[0] = m_current;
+        items[1] = m_next;
+        items[2] = m_published;
+        items[3] = m_retired;
+        m_next = NULL;
+        m_retired = NULL;
+    }
+    for (size_t i = 0; i < 4; ++i)
+    {
+        if (items[i].valid())
+            items[i]->quit(waitForThreadToExit);
+    }
+}
+
+void FFmpegPlaylistPlayer::setVolume(float volume)
+{
+    ScopedLock  lock(m_mutex);
+
+    m_volume = volume;
+    if (m_current.valid())
+        m_current->setVolume(volume);
+    if (m_next.valid())
+        m_next->setVolume(volume);
+}
+
+float FFmpegPlaylistPlayer::getVolume() const
+{
+    return m_volume;
+}
+
+double FFmpegPlaylistPlayer::getLength() const
+{
+    ScopedLock  lock(m_mutex);
+
+    return m_current.valid() ? m_current->getLength() : 0.0;
+}
+
+
+double FFmpegPlaylistPlayer::getReferenceTime () const
+{
+    return getCurrentTime();
+}
+
+double FFmpegPlaylistPlayer::getCurrentTime() const
+{
+    ScopedLock  lock(m_mutex);
+
+    return m_current.valid() ? m_current->getCurrentTime() : 0.0;
+}
+
+
+
+double FFmpegPlaylistPlayer::getFrameRate() const
+{
+    ScopedLock  lock(m_mutex);
+
+    return m_current.valid() ? m_current->getFrameRate() : 0.0;
+}
+
+
+
+bool FFmpegPlaylistPlayer::isImageTranslucent() const
+{
+    ScopedLock  lock(m_mutex);
+
+    return m_current.valid() ? m_current->isImageTranslucent() : false;
+}
+
+void FFmpegPlaylistPlayer::update(osg::NodeVisitor * nv)
+{
+    osg::ref_ptr<FFmpegPlayer>  item;
+    {
+        ScopedLock  lock(m_mutex);
+
+        item = m_current;
+    }
+    //
+    // Image refers to the last frame of current item, without copying
+    //
+    if (item.valid() == false || item->data() == NULL)
+        return;
+
+    if (item == m_published && item->getModifiedCount() == m_publishedModifiedCount)
+        return;
+
+    setImage(
+        item->s(), item->t(), item->r(), item->getInternalTextureFormat(), item->getPixelFormat(), item->getDataType(),
+        item->data(), NO_DELETE, item->getPacking()
+    );
+    setPixelAspectRatio(item->getPixelAspectRatio());
+    m_publishedModifiedCount = item->getModifiedCount();
+
+    if (item != m_published)
+    {
+        ScopedLock  lock(m_mutex);
+
+        m_retired = m_published;
+        m_retiredTick = osg::Timer::instance()->tick();
+        m_published = item;
+    }
+}
+
+size_t FFmpegPlaylistPlayer::getNumItems() const
+{
+    ScopedLock  lock(m_mutex);
+
+    return m_fileNames.size();
+}
+
+size_t FFmpegPlaylistPlayer::getCurrentItemIndex() const
+{
+    ScopedLock  lock(m_mutex);
+
+    return m_currentIndex;
+}
+
+
+
+void FFmpegPlaylistPlayer::run()
+{
+    try
+    {
+        while (m_stop == false)
+        {
+            switchFinishedItem();
+            prepareNextItem();
+
+            osg::ref_ptr<FFmpegPlayer>  retired;
+            {
+                ScopedLock  lock(m_mutex);
+
+                if (m_retired.valid() &&
+                    osg::Timer::instance()->delta_s(m_retiredTick, osg::Timer::instance()->tick()) > RetireDelaySec)
+                {
+                    retired = m_retired;
+                    m_retired = NULL;
+                }
+            }
+            retired = NULL; // released out of the lock, because it waits for threads of the item
+
+            OpenThreads::Thread::microSleep(PollMicroSec);
+        }
+    }
+
+    catch (const std::exception & error)
+    {
+        OSG_WARN << "FFmpegPlaylistPlayer::run : " << error.what() << std::endl;
+    }
+
+    catch (...)
+    {
+        OSG_WARN << "FFmpegPlaylistPlayer::run : unhandled exception" << std::endl;
+    }
+}
+
+
+
+void FFmpegPlaylistPlayer::applyLoopingMode()
+{
+    ScopedLock  lock(m_mutex);
+    //
+    // Single item loops itself gaplessly, otherwise playlist wraps to the first item
+    //
+    if (m_current.valid())
+        m_current->setLoopingMode(m_fileNames.size() == 1 ? getLoopingMode() : NO_LOOPING);
+}
+
+osg::ref_ptr<FFmpegPlayer> FFmpegPlaylistPlayer::openItem(const size_t index, const bool prefill)
+{
+    std::string                         filename;
+    osg::ref_ptr<ItemOpenedCallback>    callback;
+    float                               volume;
+    {
+        ScopedLock  lock(m_mutex);
+
+        if (index >= m_fileNames.size())
+            return NULL;
+
+        filename = m_fileNames[index];
+        callback = m_itemOpenedCallback;
+        volume = m_volume;
+    }
+    //
+    // Opening consumes options of the parameters, so each item gets own copy
+    //
+    osg::ref_ptr<FFmpegParameters>  parameters = m_parameters.valid() ? new FFmpegParameters(* m_parameters) : new FFmpegParameters;
+    osg::ref_ptr<FFmpegPlayer>      item = new FFmpegPlayer;
+
+    if (item->open(filename, parameters.get()) == false)
+    {
+        OSG_WARN << "FFmpegPlaylistPlayer: cannot open " << filename << ", it is removed from the playlist" << std::endl;
+
+        ScopedLock  lock(m_mutex);
+
+        if (index < m_fileNames.size() && m_fileNames[index] == filename)
+        {
+            m_fileNames.erase(m_fileNames.begin() + index);
+            if (index < m_currentIndex)
+                --m_currentIndex;
+        }
+        return NULL;
+    }
+    item->setVolume(volume);
+    //
+    // Item gets sink of the playlist before callback, which could attach own sinks instead
+    //
+    attachItemAudioSink(item.get());
+
+    if (callback.valid())
+        (*callback)(this, item.get());
+
+    if (prefill)
+        item->prefill();
+
+    return item;
+}
+
+const size_t FFmpegPlaylistPlayer::nextItemIndex() const
+{
+    // m_mutex should be locked
+    const size_t    index = m_currentIndex + 1;
+
+    if (index < m_fileNames.size())
+        return index;
+
+    // No next item
+    return (getLoopingMode() == LOOPING) ? 0 : m_fileNames.size();
+}
+
+void FFmpegPlaylistPlayer::prepareNextItem()
+{
+    size_t      index;
+    {
+        ScopedLock  lock(m_mutex);
+
+        if (m_next.valid())
+            return;
+
+        index = nextItemIndex();
+        if (index >= m_fileNames.size() || index == m_currentIndex)
+            return;
+    }
+    //
+    // Probing and decoding of the first frames are done out of the lock, while current item plays
+    //
+    osg::ref_ptr<FFmpegPlayer>  item = openItem(index, true);
+
+    if (item.valid())
+    {
+        ScopedLock  lock(m_mutex);
+
+        m_next = item;
+        m_nextIndex = index;
+    }
+}
+
+void FFmpegPlaylistPlayer::switchFinishedItem()
+{
+    osg::ref_ptr<FFmpegPlayer>  previous;
+    osg::ref_ptr<FFmpegPlayer>  dropped;
+    bool                        finished = false;
+    {
+        ScopedLock  lock(m_mutex);
+
+        if (_status != PLAYING || m_current.valid() == false)
+            return;
+        //
+        // Commands of the item are asynchronous, so it is paused yet for a while after play()
+        //
+        const bool  playing = (m_current->getStatus() == PLAYING);
+        if (playing)
+            m_currentStarted = true;
+
+        if (m_currentStarted == false)
+            return;
+
+        const size_t    index = nextItemIndex();
+
+        if (m_next.valid() && m_nextIndex != index)
+        {
+            dropped = m_next;
+            m_next = NULL;
+        }
+
+        if (m_next.valid())
+        {
+            if (playing == false || m_current->getCurrentTime() * 1000.0 + SwitchLeadMS >= m_current->getLength())
+            {
+                previous = setCurrentItem(m_next.get(), index);
+                m_next = NULL;
+            }
+        }
+        else if (playing == false && index >= m_fileNames.size())
+        {
+            //
+            // Last item finished, so playlist stops at the first item
+            //
+            _status = PAUSED;
+            finished = true;
+        }
+    }
+    if (finished)
+        rewind();
+}
+
+osg::ref_ptr<FFmpegPlayer> FFmpegPlaylistPlayer::setCurrentItem(FFmpegPlayer * item, const size_t index)
+{
+    osg::ref_ptr<FFmpegPlayer>  previous = m_current;
+
+    m_current = item;
+    m_currentIndex = index;
+    m_currentStarted = false;
+
+    m_current->setLoopingMode(m_fileNames.size() == 1 ? getLoopingMode() : NO_LOOPING);
+    {
+        ScopedLock  audioLock(m_audioMutex);
+
+        m_audioItem = m_current.get();
+        m_audioItemStream = m_current->getAudioStreams().empty() ? NULL : m_current->getAudioStreams()[0].get();
+    }
+
+    if (_status == PLAYING)
+        m_current->play();
+
+    if (previous.valid())
+        previous->pause();
+
+    return previous;
+}
+
+void FFmpegPlaylistPlayer::setAudioSink(osg::AudioSink * audio_sink)
+{
+    osg::ref_ptr<FFmpegPlayer>  items[2];
+    {
+        ScopedLock  lock(m_mutex);
+
+        items[0] = m_current;
+        items[1] = m_next;
+        {
+            ScopedLock  audioLock(m_audioMutex);
+
+            m_audioSink = audio_sink;
+        }
+    }
+    for (size_t i = 0; i < 2; ++i)
+    {
+        if (items[i].valid())
+            attachItemAudioSink(items[i].get());
+    }
+}
+
+void FFmpegPlaylistPlayer::attachItemAudioSink(FFmpegPlayer * item)
+{
+    {
+        ScopedLock  audioLock(m_audioMutex);
+
+        if (m_audioSink.valid() == false)
+            return;
+    }
+    if (item->getAudioStreams().empty())
+        return;
+
+    osg::ref_ptr<ItemAudioSink> sink = new ItemAudioSink(this, item);
+
+    item->getAudioStreams()[0]->setAudioSink(sink.get());
+    sink->enable();
+}
+
+osg::ref_ptr<osg::AudioSink> FFmpegPlaylistPlayer::activeAudioSink(const FFmpegPlayer * item) const
+{
+    ScopedLock  audioLock(m_audioMutex);
+
+    return (item == m_audioItem) ? m_audioSink : NULL;
+}
+
+osg::ref_ptr<osg::AudioStream> FFmpegPlaylistPlayer::currentAudioStream() const
+{
+    ScopedLock  audioLock(m_audioMutex);
+
+    return m_audioItemStream;
+}
+
+} // namespace osgFFmpeg
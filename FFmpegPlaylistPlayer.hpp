@@ -0,0 +1,145 @@
+/* Improved ffmpeg plugin for OpenSceneGraph -
+ * Copyright (C) 2014-2015 Digitalis Education Solutions, Inc. (http://DigitalisEducation.com)
+ * File author: Oktay Radzhabov (oradzhabov at jazzros dot com)
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+#ifndef HEADER_GUARD_FFMPEG_PLAYLISTPLAYER_H
+#define HEADER_GUARD_FFMPEG_PLAYLISTPLAYER_H
+
+#include <osg/ImageStream>
+#include <osg/Timer>
+#include <OpenThreads/Thread>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
+#include <vector>
+#include <string>
+#include "FFmpegPlayer.hpp"
+#include "FFmpegParameters.hpp"
+
+namespace osgFFmpeg {
+
+//
+// Plays ordered list of files as one stream. Each item is played by own FFmpegPlayer.
+// While current item plays, the next one is opened and prefilled in background,
+// so switching at the end of the item does not wait for probing and decoding.
+//
+// Image of the playlist refers to the frames of current item, so it requires update traversal.
+// Playlist has one audio stream, which plays main audio of current item. Sink attached to it plays all items:
+// each item gets own sink, which controls the sink of the playlist while the item is current.
+//
+class FFmpegPlaylistPlayer: public osg::ImageStream, public OpenThreads::Thread
+{
+public:
+    //
+    // Called from the playlist thread, when the item is opened, but is not prefilled yet.
+    // Prefilling drops audio without sink, so own audio sinks of the item(e.g. for extra tracks)
+    // should be attached here. Without callback, main audio of the item is played by the sink of the playlist.
+    //
+    struct ItemOpenedCallback : public osg::Referenced
+    {
+        virtual void            operator()(FFmpegPlaylistPlayer * playlist, FFmpegPlayer * item) = 0;
+    };
+
+                                FFmpegPlaylistPlayer();
+                                FFmpegPlaylistPlayer(const FFmpegPlaylistPlayer & player,
+                                        const osg::CopyOp & copyop = osg::CopyOp::SHALLOW_COPY);
+
+    META_Object(osgFFmpeg, FFmpegPlaylistPlayer);
+
+    // Opens the first item. Others are opened during playback
+    bool                        open(const std::vector<std::string> & filenames,
+                                        FFmpegParameters * parameters);
+
+    void                        setItemOpenedCallback(ItemOpenedCallback * callback);
+
+    virtual void                play();
+    virtual void                pause();
+    // Playlist returns to the first item
+    virtual void                rewind();
+    // Seek inside current item
+    virtual void                seek(double time);
+    virtual void                quit(bool waitForThreadToExit = true);
+
+    virtual void                setVolume(float volume);
+    virtual float               getVolume() const;
+
+    // Length and time of current item
+    virtual double              getLength() const;
+    virtual double              getReferenceTime () const;
+    virtual double              getCurrentTime() const;
+    virtual double              getFrameRate() const;
+
+    virtual bool                isImageTranslucent() const;
+
+    virtual bool                requiresUpdateCall() const { return true; }
+    virtual void                update(osg::NodeVisitor * nv);
+
+    size_t                      getNumItems() const;
+    size_t                      getCurrentItemIndex() const;
+
+private:
+    typedef OpenThreads::Mutex              Mutex;
+    typedef OpenThreads::ScopedLock<Mutex>  ScopedLock;
+
+    class AudioStreamProxy;
+    class ItemAudioSink;
+    friend class AudioStreamProxy;
+    friend class ItemAudioSink;
+
+    virtual                     ~FFmpegPlaylistPlayer();
+    virtual void                run();
+    virtual void                applyLoopingMode();
+
+    // Opens item and prefills it if required. Broken item is removed from the list, and NULL is returned
+    osg::ref_ptr<FFmpegPlayer>  openItem(const size_t index, const bool prefill);
+    const size_t                nextItemIndex() const;
+    void                        prepareNextItem();
+    void                        switchFinishedItem();
+    // Current item is replaced by [item], which starts to play if playlist is playing.
+    // Should be called with locked \m_mutex. Returned previous item should be released out of the lock.
+    osg::ref_ptr<FFmpegPlayer>  setCurrentItem(FFmpegPlayer * item, const size_t index);
+
+    // Sink of the playlist is attached by its audio stream
+    void                        setAudioSink(osg::AudioSink * audio_sink);
+    // Attach own sink to the main audio of [item], if the playlist has sink
+    void                        attachItemAudioSink(FFmpegPlayer * item);
+    // Sink of the playlist, if [item] is current. Otherwise NULL
+    osg::ref_ptr<osg::AudioSink>    activeAudioSink(const FFmpegPlayer * item) const;
+    // Main audio stream of current item
+    osg::ref_ptr<osg::AudioStream>  currentAudioStream() const;
+
+    mutable Mutex                       m_mutex;
+    std::vector<std::string>            m_fileNames;
+    osg::ref_ptr<FFmpegParameters>      m_parameters;   // Each item gets own copy, because opening consumes options
+    osg::ref_ptr<ItemOpenedCallback>    m_itemOpenedCallback;
+    osg::ref_ptr<FFmpegPlayer>          m_current;
+    size_t                              m_currentIndex;
+    bool                                m_currentStarted;   // Current item has been seen playing, so its pause means the end
+    osg::ref_ptr<FFmpegPlayer>          m_next;
+    size_t                              m_nextIndex;
+    osg::ref_ptr<FFmpegPlayer>          m_published;        // Item, frames of which are referenced by the image
+    unsigned int                        m_publishedModifiedCount;
+    osg::ref_ptr<FFmpegPlayer>          m_retired;          // Previous published item. Its frame could be in use by drawing yet
+    osg::Timer_t                        m_retiredTick;
+    float                               m_volume;
+    volatile bool                       m_stop;
+    mutable Mutex                       m_audioMutex;   // Locked by sinks of the items, so it is locked after \m_mutex
+    osg::ref_ptr<osg::AudioSink>        m_audioSink;    // Sink of the playlist. Guarded by \m_audioMutex
+    osg::ref_ptr<osg::AudioStream>      m_audioItemStream; // Main audio stream of current item. Guarded by \m_audioMutex
+    const FFmpegPlayer *                m_audioItem;    // Item, which controls the sink of the playlist. Guarded by \m_audioMutex
+};
+
+} // namespace osgFFmpeg
+
+#endif // HEADER_GUARD_FFMPEG_PLAYLISTPLAYER_H
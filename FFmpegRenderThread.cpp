@@ -70,22 +70,19 @@ FFmpegRenderThread::run()
 
         osg::Timer              loopTimer;
         loopTimer.setStartTick(0);
-        const float             frameTimeMS = 1000.0f / m_pLibAvStream->fps();
+        // Frames are changed faster or slower according to playback rate
+        const float             frameTimeMS = 1000.0f / (m_pLibAvStream->fps() * fabs(m_pLibAvStream->getPlaybackRate()));
         double                  tick_start_ms = -1.0;
         double                  tick_end_ms;
         double                  frame_ms;
         double                  dist_frame_ms;
         int                     iErr;
         //
-        GLint                   internalTexFmt;
-        GLint                   pixFmt;
-        FFmpegFileHolder::getGLPixFormats (m_pFileHolder->getPixFormat(), internalTexFmt, pixFmt);
-        //
         while (m_renderingThreadStop == false)
         {
             //
             //
-            timePosMS = m_pLibAvStream->GetPlaybackTime();
+            timePosMS = m_pLibAvStream->GetClockTime();
 
             iErr = m_pLibAvStream->GetFramePtr (timePosMS, pFramePtr);
             //
@@ -109,12 +106,7 @@ FFmpegRenderThread::run()
                         OpenThreads::Thread::microSleep(1000 * dist_frame_ms / 2);
                     }
                 }
-                m_pImgStream->setImage(
-                    m_pFileHolder->width(),
-                    m_pFileHolder->height(),
-                    1, internalTexFmt, pixFmt, GL_UNSIGNED_BYTE,
-                    pFramePtr, osg::Image::NO_DELETE
-                );
+                PublishFrame(pFramePtr);
                 tick_start_ms = loopTimer.time_m();
             }
 
@@ -132,6 +124,21 @@ FFmpegRenderThread::run()
     }
 }
 
+void
+FFmpegRenderThread::PublishFrame(unsigned char * pFramePtr)
+{
+    GLint                   internalTexFmt;
+    GLint                   pixFmt;
+    FFmpegFileHolder::getGLPixFormats (m_pFileHolder->getPixFormat(), internalTexFmt, pixFmt);
+
+    m_pImgStream->setImage(
+        m_pFileHolder->width(),
+        m_pFileHolder->height(),
+        1, internalTexFmt, pixFmt, GL_UNSIGNED_BYTE,
+        pFramePtr, osg::Image::NO_DELETE
+    );
+}
+
 void
 FFmpegRenderThread::quit(bool waitForThreadToExit)
 {
@@ -42,6 +42,8 @@ public:
 
     void                        Start();
     void                        Stop();
+    // Set [pFramePtr] as the image of the stream
+    void                        PublishFrame(unsigned char * pFramePtr);
     virtual void                quit(bool waitForThreadToExit = true);
 };
 
@@ -109,16 +109,22 @@ FFmpegStreamer::getFrame() const
 
 
 void
-FFmpegStreamer::setAudioSink(osg::AudioSink * audio_sink)
+FFmpegStreamer::setAudioSink(const size_t trackNb, osg::AudioSink * audio_sink)
 {
-    m_pLibAvStreamImpl->setAudioSink(audio_sink);
+    if (trackNb == 0)
+        m_pLibAvStreamImpl->setAudioSink(audio_sink);
+    else
+        m_pLibAvStreamImpl->setExtraAudioSink(trackNb - 1, audio_sink);
 }
 
 
 void
-FFmpegStreamer::audio_fillBuffer(void * buffer, size_t size)
+FFmpegStreamer::audio_fillBuffer(const size_t trackNb, void * buffer, size_t size)
 {
-    m_pLibAvStreamImpl->GetAudio(buffer, size);
+    if (trackNb == 0)
+        m_pLibAvStreamImpl->GetAudio(buffer, size);
+    else
+        m_pLibAvStreamImpl->GetExtraAudio(trackNb - 1, buffer, size);
 }
 
 void
@@ -130,6 +136,15 @@ FFmpegStreamer::play()
     }
 }
 
+void
+FFmpegStreamer::prefill()
+{
+    if (m_holder != NULL)
+    {
+        m_pLibAvStreamImpl->Prefill ();
+    }
+}
+
 void
 FFmpegStreamer::pause()
 {
@@ -148,6 +163,53 @@ FFmpegStreamer::seek(const unsigned long & timeMS)
     }
 }
 
+void
+FFmpegStreamer::setPlaybackRate(const double & rate)
+{
+    if (m_holder != NULL)
+    {
+        m_pLibAvStreamImpl->setPlaybackRate (rate);
+    }
+}
+
+const double
+FFmpegStreamer::getPlaybackRate() const
+{
+    return m_pLibAvStreamImpl->getPlaybackRate();
+}
+
+const int
+FFmpegStreamer::step(const int direction)
+{
+    if (m_holder != NULL)
+    {
+        return m_pLibAvStreamImpl->Step (direction);
+    }
+    return -1;
+}
+
+void
+FFmpegStreamer::setVisible(const bool visible)
+{
+    m_pLibAvStreamImpl->setVisible (visible);
+}
+
+void
+FFmpegStreamer::setClock(FFmpegIClock * clock)
+{
+    m_pLibAvStreamImpl->setClock (clock);
+}
+
+const int
+FFmpegStreamer::renderFrame(const unsigned long & timeMS)
+{
+    if (m_holder != NULL)
+    {
+        return m_pLibAvStreamImpl->RenderFrame (timeMS);
+    }
+    return -1;
+}
+
 const double
 FFmpegStreamer::getCurrentTimeSec() const
 {
@@ -30,6 +30,7 @@ namespace osgFFmpeg {
 class FFmpegPlayer;
 class FFmpegFileHolder;
 class FFmpegILibAvStreamImpl;
+class FFmpegIClock;
 class FFmpegStreamer
 {
     const FFmpegFileHolder *                m_holder;
@@ -44,8 +45,9 @@ public:
     
     const unsigned char*    getFrame() const;
 
-    void                    setAudioSink(osg::AudioSink * audio_sink);
-    void                    audio_fillBuffer(void * buffer, size_t size);
+    // [trackNb] ZERO is the main audio track, others are extra tracks
+    void                    setAudioSink(const size_t trackNb, osg::AudioSink * audio_sink);
+    void                    audio_fillBuffer(const size_t trackNb, void * buffer, size_t size);
     //
     void                    loop(const bool loop);
     const bool              loop() const;
@@ -57,8 +59,20 @@ public:
     void                    setAudioBalance(const float & balance);
     //
     void                    play();
+    // Decode first frames and audio without starting of playback, so next play() starts at once
+    void                    prefill();
     void                    pause();
     void                    seek(const unsigned long & timeMS);
+    // 1.0 is normal speed, negative value means reverse direction
+    void                    setPlaybackRate(const double & rate);
+    const double            getPlaybackRate() const;
+    // Move exactly one frame forward(direction > 0) or backward(direction < 0). Playback should be paused.
+    const int               step(const int direction);
+    void                    setVisible(const bool visible);
+    // Frames are selected by time of external [clock]. NULL restores own clock
+    void                    setClock(FFmpegIClock * clock);
+    // Offline rendering: publish exactly the frame of [timeMS], when it is decoded
+    const int               renderFrame(const unsigned long & timeMS);
     const double            getCurrentTimeSec() const;
 };
 
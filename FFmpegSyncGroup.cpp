@@ -0,0 +1,203 @@
+/* Improved ffmpeg plugin for OpenSceneGraph -
+ * Copyright (C) 2014-2015 Digitalis Education Solutions, Inc. (http://DigitalisEducation.com)
+ * File author: Oktay Radzhabov (oradzhabov at jazzros dot com)
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+#include "FFmpegSyncGroup.hpp"
+#include <algorithm>
+
+namespace osgFFmpeg
+{
+
+FFmpegSyncGroup::FFmpegSyncGroup()
+:m_playing(false)
+{
+}
+
+FFmpegSyncGroup::~FFmpegSyncGroup()
+{
+}
+
+void
+FFmpegSyncGroup::lockPlayers(LockedPlayerList & players)
+{
+    PlayerList::iterator    it = m_players.begin();
+
+    while (it != m_players.end())
+    {
+        osg::ref_ptr<FFmpegPlayer>  player;
+
+        if (it->lock(player))
+        {
+            players.push_back(player);
+            ++it;
+        }
+        else
+        {
+            it = m_players.erase(it);
+        }
+    }
+}
+
+void
+FFmpegSyncGroup::join(FFmpegPlayer * player)
+{
+    if (player == NULL)
+        return;
+
+    bool                playing;
+    {
+        ScopedLock      lock (m_mutex);
+
+        for (PlayerList::const_iterator it = m_players.begin(); it != m_players.end(); ++it)
+        {
+            if (it->get() == player)
+                return;
+        }
+        m_players.push_back(player);
+        playing = m_playing;
+    }
+    //
+    // Player is commanded out of the lock, because its threads ask the time of the group
+    //
+    player->setClock(this);
+    player->seek(GetClockTime());
+    if (playing)
+        player->play();
+}
+
+void
+FFmpegSyncGroup::leave(FFmpegPlayer * player)
+{
+    if (player == NULL)
+        return;
+    {
+        ScopedLock      lock (m_mutex);
+
+        PlayerList::iterator    it = m_players.begin();
+        while (it != m_players.end() && it->get() != player)
+            ++it;
+
+        if (it == m_players.end())
+            return;
+
+        m_players.erase(it);
+    }
+    player->setClock(NULL);
+}
+
+size_t
+FFmpegSyncGroup::getNumPlayers() const
+{
+    ScopedLock          lock (m_mutex);
+
+    return m_players.size();
+}
+
+void
+FFmpegSyncGroup::setMasterClock(FFmpegIClock * clock)
+{
+    ScopedLock          lock (m_mutex);
+
+    m_masterClock = clock;
+}
+
+void
+FFmpegSyncGroup::play()
+{
+    LockedPlayerList    players;
+    {
+        ScopedLock      lock (m_mutex);
+
+        lockPlayers(players);
+        if (m_playing == false)
+        {
+            m_timer.Start();
+            m_playing = true;
+        }
+    }
+    for (size_t i = 0; i < players.size(); ++i)
+        players[i]->play();
+}
+
+void
+FFmpegSyncGroup::pause()
+{
+    LockedPlayerList    players;
+    {
+        ScopedLock      lock (m_mutex);
+
+        lockPlayers(players);
+        if (m_playing == true)
+        {
+            m_timer.Stop();
+            m_playing = false;
+        }
+    }
+    for (size_t i = 0; i < players.size(); ++i)
+        players[i]->pause();
+}
+
+void
+FFmpegSyncGroup::seek(const unsigned long & timeMS)
+{
+    LockedPlayerList    players;
+    bool                playing;
+    {
+        ScopedLock      lock (m_mutex);
+
+        lockPlayers(players);
+        playing = m_playing;
+
+        m_timer.Reset();
+        m_timer.ElapsedMilliseconds(timeMS);
+        if (playing)
+            m_timer.Start();
+    }
+    //
+    // Seeking pauses the player, so playing members are restarted. They catch up the time of the group
+    // as soon as their first frames are decoded.
+    //
+    for (size_t i = 0; i < players.size(); ++i)
+    {
+        players[i]->seek(timeMS);
+        if (playing)
+            players[i]->play();
+    }
+}
+
+const bool
+FFmpegSyncGroup::isPlaying() const
+{
+    ScopedLock          lock (m_mutex);
+
+    return m_playing;
+}
+
+const unsigned long
+FFmpegSyncGroup::GetClockTime() const
+{
+    osg::ref_ptr<FFmpegIClock>  masterClock;
+    {
+        ScopedLock      lock (m_mutex);
+
+        if (m_masterClock.valid() == false)
+            return m_timer.ElapsedMilliseconds();
+
+        masterClock = m_masterClock;
+    }
+    return masterClock->GetClockTime();
+}
+
+} // namespace osgFFmpeg
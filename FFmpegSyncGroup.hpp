@@ -0,0 +1,83 @@
+/* Improved ffmpeg plugin for OpenSceneGraph -
+ * Copyright (C) 2014-2015 Digitalis Education Solutions, Inc. (http://DigitalisEducation.com)
+ * File author: Oktay Radzhabov (oradzhabov at jazzros dot com)
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+#ifndef HEADER_GUARD_FFMPEG_SYNCGROUP_H
+#define HEADER_GUARD_FFMPEG_SYNCGROUP_H
+
+#include <osg/observer_ptr>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
+#include <vector>
+#include "FFmpegIClock.hpp"
+#include "FFmpegTimer.hpp"
+#include "FFmpegPlayer.hpp"
+
+namespace osgFFmpeg {
+
+//
+// Group of players, which show frames of the same time, e.g. tiles of the video wall.
+// Group is the master clock of its members: each member selects its frames by the time of the group,
+// so members do not drift apart, whenever they have been started. Time of the group is measured by
+// own timer, or it is taken from external clock(e.g. timecode or house clock).
+//
+// Playback commands of the group are applied to all members. Audio of members is played,
+// but it does not drive the playback time.
+//
+class FFmpegSyncGroup : public FFmpegIClock
+{
+public:
+                                    FFmpegSyncGroup();
+
+    // Player follows the time of the group. It is moved to the current time of the group
+    void                            join(FFmpegPlayer * player);
+    // Player continues by own clock
+    void                            leave(FFmpegPlayer * player);
+    size_t                          getNumPlayers() const;
+
+    // Time of the group is taken from [clock] instead of own timer. NULL restores own timer
+    void                            setMasterClock(FFmpegIClock * clock);
+
+    // Start all members at the same time point
+    void                            play();
+    void                            pause();
+    // Move all members to [timeMS]. External master clock should be moved by its owner
+    void                            seek(const unsigned long & timeMS);
+    const bool                      isPlaying() const;
+
+    virtual const unsigned long     GetClockTime() const;
+
+protected:
+    virtual                         ~FFmpegSyncGroup();
+
+private:
+    typedef OpenThreads::Mutex              Mutex;
+    typedef OpenThreads::ScopedLock<Mutex>  ScopedLock;
+    typedef std::vector<osg::observer_ptr<FFmpegPlayer> >   PlayerList;
+    typedef std::vector<osg::ref_ptr<FFmpegPlayer> >        LockedPlayerList;
+
+    // Alive members are locked, deleted ones are removed. Should be called with locked \m_mutex
+    void                            lockPlayers(LockedPlayerList & players);
+
+    mutable Mutex                   m_mutex;
+    PlayerList                      m_players;
+    FFmpegTimer                     m_timer;
+    osg::ref_ptr<FFmpegIClock>      m_masterClock;
+    bool                            m_playing;
+};
+
+} // namespace osgFFmpeg
+
+#endif // HEADER_GUARD_FFMPEG_SYNCGROUP_H
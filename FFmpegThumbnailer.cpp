@@ -0,0 +1,354 @@
+/* Improved ffmpeg plugin for OpenSceneGraph -
+ * Copyright (C) 2014-2015 Digitalis Education Solutions, Inc. (http://DigitalisEducation.com)
+ * File author: Oktay Radzhabov (oradzhabov at jazzros dot com)
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+#include "FFmpegThumbnailer.hpp"
+#include <OpenThreads/Thread>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
+#include <algorithm>
+#include <cmath>
+
+namespace osgFFmpeg {
+
+namespace {
+
+class ThumbnailWorker : public OpenThreads::Thread
+{
+    std::vector<FFmpegThumbnailJob> &   m_jobs;
+    size_t &                            m_nextJob;
+    OpenThreads::Mutex &                m_mutex;
+    const unsigned int                  m_maxWidth;
+    const unsigned int                  m_maxHeight;
+public:
+    ThumbnailWorker(std::vector<FFmpegThumbnailJob> & jobs, size_t & nextJob, OpenThreads::Mutex & mutex,
+                    const unsigned int maxWidth, const unsigned int maxHeight)
+        :m_jobs(jobs),
+        m_nextJob(nextJob),
+        m_mutex(mutex),
+        m_maxWidth(maxWidth),
+        m_maxHeight(maxHeight)
+    {
+    }
+
+    virtual void run()
+    {
+        while (true)
+        {
+            size_t  jobIndex;
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock(m_mutex);
+
+                if (m_nextJob >= m_jobs.size())
+                    break;
+
+                jobIndex = m_nextJob++;
+            }
+            FFmpegThumbnailer::grabJob(m_jobs[jobIndex], m_maxWidth, m_maxHeight);
+        }
+    }
+};
+
+} // namespace
+
+FFmpegThumbnailer::FFmpegThumbnailer()
+:m_fmt_ctx(NULL),
+m_videoStreamIndex(-1),
+m_pFrame(NULL),
+m_img_convert_ctx(NULL),
+m_maxWidth(0),
+m_maxHeight(0)
+{
+}
+
+FFmpegThumbnailer::~FFmpegThumbnailer()
+{
+    close();
+}
+
+const int
+FFmpegThumbnailer::open(const std::string & filename, const unsigned int maxWidth, const unsigned int maxHeight)
+{
+    int                 err;
+
+    close();
+
+    if (maxWidth == 0 || maxHeight == 0)
+        return -1;
+
+    m_maxWidth = maxWidth;
+    m_maxHeight = maxHeight;
+
+    if ((err = avformat_open_input(&m_fmt_ctx, filename.c_str(), NULL, NULL)) < 0)
+    {
+        av_log(NULL, AV_LOG_ERROR, "Cannot open file %s for thumbnails", filename.c_str());
+        m_fmt_ctx = NULL;
+        return err;
+    }
+#if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(53, 5, 0)
+    if ((err = avformat_find_stream_info(m_fmt_ctx, NULL)) < 0)
+#else
+    if ((err = av_find_stream_info(m_fmt_ctx)) < 0)
+#endif
+    {
+        close();
+        return err;
+    }
+
+    for (unsigned int i = 0; i < m_fmt_ctx->nb_streams; i++)
+    {
+        if (m_fmt_ctx->streams[i]->codec->codec_type == AVMEDIA_TYPE_VIDEO)
+        {
+            m_videoStreamIndex = i;
+            break;
+        }
+    }
+    if (m_videoStreamIndex < 0)
+    {
+        av_log(NULL, AV_LOG_WARNING, "Opened file has not video-streams");
+        close();
+        return -1;
+    }
+
+    AVCodecContext *    pCodecCtx   = m_fmt_ctx->streams[m_videoStreamIndex]->codec;
+    AVCodec *           codec       = avcodec_find_decoder(pCodecCtx->codec_id);
+
+    if (codec == NULL || pCodecCtx->width <= 0 || pCodecCtx->height <= 0)
+    {
+        av_log(NULL, AV_LOG_ERROR, "Invalid video codec");
+        close();
+        return -1;
+    }
+    //
+    // Decoder could reduce resolution itself by power of 2, which is much faster than full decoding and downscaling
+    //
+    const double        reduceRatio = std::min((double)pCodecCtx->width / (double)m_maxWidth,
+                                                (double)pCodecCtx->height / (double)m_maxHeight);
+    int                 lowres      = 0;
+
+    while (lowres < codec->max_lowres && lowres < 3 && reduceRatio >= (double)(2 << lowres))
+        lowres++;
+
+    pCodecCtx->lowres = lowres;
+    // Only key-frames are required, so deblocking could be skipped too
+    pCodecCtx->skip_frame = AVDISCARD_NONKEY;
+    pCodecCtx->skip_loop_filter = AVDISCARD_ALL;
+    // Thumbnails of many files are processed in parallel by worker pool, so one thread is used per file
+    pCodecCtx->thread_count = 1;
+
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(53, 8, 0)
+    if (avcodec_open2 (pCodecCtx, codec, NULL) < 0)
+#else
+    if (avcodec_open (pCodecCtx, codec) < 0)
+#endif
+    {
+        av_log(NULL, AV_LOG_ERROR, "Could not open the required codec for thumbnails");
+        m_videoStreamIndex = -1;
+        close();
+        return -1;
+    }
+
+    m_pFrame = OSG_ALLOC_FRAME();
+
+    return 0;
+}
+
+void
+FFmpegThumbnailer::close()
+{
+    if (m_pFrame)
+    {
+        OSG_FREE_FRAME (& m_pFrame);
+        m_pFrame = NULL;
+    }
+#ifdef USE_SWSCALE
+    if (m_img_convert_ctx)
+    {
+        sws_freeContext(m_img_convert_ctx);
+        m_img_convert_ctx = NULL;
+    }
+#endif
+    if (m_fmt_ctx)
+    {
+        if (m_videoStreamIndex >= 0)
+            avcodec_close(m_fmt_ctx->streams[m_videoStreamIndex]->codec);
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(53, 17, 0)
+        avformat_close_input(&m_fmt_ctx);
+#else
+        av_close_input_file(m_fmt_ctx);
+#endif
+        m_fmt_ctx = NULL;
+    }
+    m_videoStreamIndex = -1;
+}
+
+const int
+FFmpegThumbnailer::decodeKeyFrame(const double & timeMS)
+{
+    AVCodecContext *    pCodecCtx       = m_fmt_ctx->streams[m_videoStreamIndex]->codec;
+    const int64_t       start_time      = (m_fmt_ctx->start_time != AV_NOPTS_VALUE) ? m_fmt_ctx->start_time : 0;
+    AVRational          time_base_q;
+
+    time_base_q.num = 1;
+    time_base_q.den = AV_TIME_BASE;
+
+    const int64_t       seek_target     = av_rescale_q ((int64_t)(std::max(0.0, timeMS) * (AV_TIME_BASE / 1000)) + start_time,
+                                                        time_base_q,
+                                                        m_fmt_ctx->streams[m_videoStreamIndex]->time_base);
+
+    if (av_seek_frame (m_fmt_ctx, m_videoStreamIndex, seek_target, AVSEEK_FLAG_BACKWARD) < 0 &&
+        av_seek_frame (m_fmt_ctx, m_videoStreamIndex, seek_target, AVSEEK_FLAG_ANY) < 0)
+    {
+        av_log(NULL, AV_LOG_ERROR, "Cannot seek video frame");
+        return -1;
+    }
+    avcodec_flush_buffers(pCodecCtx);
+
+    AVPacket            packet;
+    int                 frameFinished   = 0;
+
+    av_init_packet(&packet);
+    packet.data = NULL;
+    packet.size = 0;
+
+    while (frameFinished == 0 && av_read_frame(m_fmt_ctx, &packet) >= 0)
+    {
+        if (packet.stream_index == m_videoStreamIndex)
+        {
+            if (avcodec_decode_video2 (pCodecCtx, m_pFrame, &frameFinished, &packet) < 0)
+                frameFinished = 0;
+        }
+        av_free_packet(&packet);
+    }
+    //
+    // End of stream reached, but decoder could still hold delayed frame
+    //
+    if (frameFinished == 0)
+    {
+        packet.data = NULL;
+        packet.size = 0;
+        if (avcodec_decode_video2 (pCodecCtx, m_pFrame, &frameFinished, &packet) < 0)
+            frameFinished = 0;
+    }
+
+    return (frameFinished != 0) ? 0 : -1;
+}
+
+osg::Image *
+FFmpegThumbnailer::convertFrame()
+{
+#ifdef USE_SWSCALE
+    AVCodecContext *    pCodecCtx   = m_fmt_ctx->streams[m_videoStreamIndex]->codec;
+    //
+    // Decoded frame is reduced by lowres, so its own size is the source size of the scaler
+    //
+    const int           srcWidth    = (m_pFrame->width > 0) ? m_pFrame->width : pCodecCtx->width;
+    const int           srcHeight   = (m_pFrame->height > 0) ? m_pFrame->height : pCodecCtx->height;
+    //
+    // Fit thumbnail into required size with display aspect ratio
+    //
+    double              displayWidth = srcWidth;
+
+    if (pCodecCtx->sample_aspect_ratio.num != 0 && pCodecCtx->sample_aspect_ratio.den != 0)
+        displayWidth *= av_q2d(pCodecCtx->sample_aspect_ratio);
+
+    const double        scale       = std::min((double)m_maxWidth / displayWidth, (double)m_maxHeight / (double)srcHeight);
+    const int           width       = std::max(2, (int)floor(displayWidth * scale + 0.5));
+    const int           height      = std::max(2, (int)floor((double)srcHeight * scale + 0.5));
+
+    m_img_convert_ctx = sws_getCachedContext(m_img_convert_ctx,
+                                            srcWidth, srcHeight, pCodecCtx->pix_fmt,
+                                            width, height, AV_PIX_FMT_RGB24,
+                                            SWS_BILINEAR, NULL, NULL, NULL);
+    if (m_img_convert_ctx == NULL)
+    {
+        av_log(NULL, AV_LOG_ERROR, "Cannot initialize the thumbnail conversion context!");
+        return NULL;
+    }
+
+    osg::ref_ptr<osg::Image>    image = new osg::Image;
+
+    image->allocateImage(width, height, 1, GL_RGB, GL_UNSIGNED_BYTE, 1);
+    image->setInternalTextureFormat(GL_RGB);
+    image->setOrigin(osg::Image::TOP_LEFT);
+
+    uint8_t *           dstData[4]      = { image->data(), NULL, NULL, NULL };
+    int                 dstLinesize[4]  = { (int)image->getRowSizeInBytes(), 0, 0, 0 };
+
+    sws_scale(m_img_convert_ctx, m_pFrame->data, m_pFrame->linesize, 0, srcHeight, dstData, dstLinesize);
+
+    return image.release();
+#else
+    av_log(NULL, AV_LOG_ERROR, "Thumbnails require swscale");
+    return NULL;
+#endif
+}
+
+osg::Image *
+FFmpegThumbnailer::grab(const double & timeMS)
+{
+    if (m_fmt_ctx == NULL || m_pFrame == NULL)
+        return NULL;
+
+    if (decodeKeyFrame(timeMS) < 0)
+        return NULL;
+
+    return convertFrame();
+}
+
+const int
+FFmpegThumbnailer::grabJob(FFmpegThumbnailJob & job, const unsigned int maxWidth, const unsigned int maxHeight)
+{
+    FFmpegThumbnailer   thumbnailer;
+    int                 grabbedNb   = 0;
+
+    job.Images.clear();
+
+    const int           err         = thumbnailer.open(job.FileName, maxWidth, maxHeight);
+    if (err < 0)
+        return err;
+
+    for (size_t i = 0; i < job.TimesMS.size(); ++i)
+    {
+        job.Images.push_back(thumbnailer.grab(job.TimesMS[i]));
+
+        if (job.Images.back().valid())
+            grabbedNb++;
+    }
+    return grabbedNb;
+}
+
+void
+FFmpegThumbnailer::grabJobs(std::vector<FFmpegThumbnailJob> & jobs, const unsigned int maxWidth, const unsigned int maxHeight, const unsigned int threadNb)
+{
+    size_t              nextJob     = 0;
+    OpenThreads::Mutex  mutex;
+    const unsigned int  workerNb    = std::min((size_t)((threadNb > 0) ? threadNb : std::max(1, OpenThreads::GetNumberOfProcessors())),
+                                                jobs.size());
+    std::vector<ThumbnailWorker *>  workers;
+
+    for (unsigned int i = 0; i < workerNb; ++i)
+    {
+        workers.push_back(new ThumbnailWorker(jobs, nextJob, mutex, maxWidth, maxHeight));
+        workers.back()->start();
+    }
+    for (unsigned int i = 0; i < workers.size(); ++i)
+    {
+        workers[i]->join();
+        delete workers[i];
+    }
+}
+
+} // namespace osgFFmpeg
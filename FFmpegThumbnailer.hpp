@@ -0,0 +1,73 @@
+/* Improved ffmpeg plugin for OpenSceneGraph -
+ * Copyright (C) 2014-2015 Digitalis Education Solutions, Inc. (http://DigitalisEducation.com)
+ * File author: Oktay Radzhabov (oradzhabov at jazzros dot com)
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+#ifndef HEADER_GUARD_FFMPEG_THUMBNAILER_H
+#define HEADER_GUARD_FFMPEG_THUMBNAILER_H
+
+#include "FFmpegHeaders.hpp"
+#include <osg/Image>
+#include <osg/ref_ptr>
+#include <string>
+#include <vector>
+
+namespace osgFFmpeg {
+
+// Thumbnails of one file
+struct FFmpegThumbnailJob
+{
+    std::string                             FileName;
+    std::vector<double>                     TimesMS;
+    // Output. Image is NULL if frame for corresponding time has not been decoded
+    std::vector< osg::ref_ptr<osg::Image> > Images;
+};
+
+//
+// Fast extraction of small images(thumbnails, poster-frames) without player setup.
+// File is opened once, each image is the key-frame before required time,
+// decoded with reduced resolution (decoder's \lowres, if supported) and downscaled to required size.
+//
+class FFmpegThumbnailer
+{
+private:
+    AVFormatContext *       m_fmt_ctx;
+    int                     m_videoStreamIndex;
+    AVFrame *               m_pFrame;
+    struct SwsContext *     m_img_convert_ctx;
+    unsigned int            m_maxWidth;
+    unsigned int            m_maxHeight;
+
+    const int               decodeKeyFrame(const double & timeMS);
+    osg::Image *            convertFrame();
+public:
+                            FFmpegThumbnailer();
+                            ~FFmpegThumbnailer();
+
+    // Thumbnail fits into [maxWidth x maxHeight] with display aspect ratio of the video
+    const int               open(const std::string & filename, const unsigned int maxWidth, const unsigned int maxHeight);
+    void                    close();
+
+    // Returns RGB image of the key-frame before [timeMS] or NULL
+    osg::Image *            grab(const double & timeMS);
+
+    // Fill [job.Images]. Returns number of grabbed images or negative value if file could not be opened
+    static const int        grabJob(FFmpegThumbnailJob & job, const unsigned int maxWidth, const unsigned int maxHeight);
+    // Process many files by pool of [threadNb] workers (0 - by number of processors)
+    static void             grabJobs(std::vector<FFmpegThumbnailJob> & jobs, const unsigned int maxWidth, const unsigned int maxHeight, const unsigned int threadNb = 0);
+};
+
+} // namespace osgFFmpeg
+
+#endif // HEADER_GUARD_FFMPEG_THUMBNAILER_H
@@ -20,6 +20,7 @@ namespace osgFFmpeg
 {
 
 FFmpegTimer::FFmpegTimer()
+:m_rate(1.0)
 {
     Reset();
 }
@@ -65,7 +66,12 @@ FFmpegTimer::ElapsedMilliseconds() const
     {
         spent_time_ms = m_timer.time_m() - m_start_time_ms;
     }
-    return m_offset + spent_time_ms;
+    //
+    // Elapsed time runs with playback rate, but could not be less than ZERO-time point
+    //
+    const double elapsed_ms = (double)m_offset + (double)spent_time_ms * m_rate;
+
+    return (elapsed_ms > 0.0) ? (unsigned long)elapsed_ms : 0;
 }
 
 void
@@ -74,6 +80,18 @@ FFmpegTimer::ElapsedMilliseconds(const unsigned long & ms)
     m_offset = ms;
 }
 
+void
+FFmpegTimer::PlaybackRate(const double & rate)
+{
+    m_rate = rate;
+}
+
+const double
+FFmpegTimer::PlaybackRate() const
+{
+    return m_rate;
+}
+
 
 
 } // namespace osgFFmpeg
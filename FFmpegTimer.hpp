@@ -29,6 +29,7 @@ class FFmpegTimer
     unsigned long           m_start_time_ms;
     unsigned long           m_stop_time_ms;
     unsigned long           m_offset;
+    double                  m_rate;     // Playback rate. Negative value means reverse direction
 public:
                         FFmpegTimer();
 
@@ -38,6 +39,10 @@ public:
 
     void                ElapsedMilliseconds(const unsigned long & ms);
     const unsigned long ElapsedMilliseconds() const;
+
+    // Should be changed only when timer is stopped
+    void                PlaybackRate(const double & rate);
+    const double        PlaybackRate() const;
 };
 
 } // namespace osgFFmpeg
@@ -16,6 +16,7 @@
 
 #include "FFmpegVideoReader.hpp"
 #include "FFmpegParameters.hpp"
+#include "FFmpegMemorySource.hpp"
 #ifdef USE_VDPAU
     #include "VDPAU/VDPAUDecoder.hpp"
 #endif // USE_VDPAU
@@ -23,6 +24,7 @@
 #include <osg/Timer>
 #include <string>
 #include <stdexcept>
+#include <cmath>
 
 namespace osgFFmpeg {
 
@@ -67,6 +69,8 @@ FFmpegVideoReader::openFile(const char *filename,
     m_is_video_duration_determined      = 0;
     m_video_duration                    = 0;
     m_pExtDecoder                       = NULL;
+    m_prefetcher                        = NULL;
+    m_ownContext                        = NULL;
     m_pixelFormat                       = PIX_FMT_BGR24; // Default value for case w/o HW acceleration
 
     if (std::string(filename).compare(0, 5, "/dev/")==0)
@@ -102,6 +106,14 @@ FFmpegVideoReader::openFile(const char *filename,
         // todo: should be tested for case when \parameters has values
         iformat = parameters ? parameters->getFormat() : 0;
         AVIOContext* context = parameters ? parameters->getContext() : 0;
+        //
+        // Memory source or memory-mapped local file is read by own IO context
+        //
+        if (context == NULL)
+        {
+            m_ownContext = FFmpegMemorySource::openContext(filename, parameters);
+            context = m_ownContext;
+        }
         if (context != NULL)
         {
             fmt_ctx = avformat_alloc_context();
@@ -141,9 +153,22 @@ FFmpegVideoReader::openFile(const char *filename,
     {
         threadNb = atoi(dictEntry->value);
     }
+#ifdef OSG_INTERRUPT_CALLBACK
+    //
+    // Stop of prefetcher aborts its read, which is blocked by stalled network source
+    //
+    if (fmt_ctx == NULL)
+        fmt_ctx = avformat_alloc_context();
+    if (fmt_ctx != NULL)
+    {
+        fmt_ctx->interrupt_callback.callback = FFmpegPacketPrefetcher::interruptCallback;
+        fmt_ctx->interrupt_callback.opaque = & m_prefetcher;
+    }
+#endif // OSG_INTERRUPT_CALLBACK
     if ((err = avformat_open_input(&fmt_ctx, filename, iformat, parameters->getOptions())) < 0)
     {
         av_log(NULL, AV_LOG_ERROR, "Cannot open file %s for video", filename);
+        FFmpegMemorySource::closeContext(& m_ownContext);
         return err;
     }
     //
@@ -170,11 +195,13 @@ FFmpegVideoReader::openFile(const char *filename,
 // version 53.7.0 (!)."
 #if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(53, 5, 0)
     if ((err = avformat_find_stream_info(fmt_ctx, NULL)) < 0)
-        return err;
 #else
     if ((err = av_find_stream_info(fmt_ctx)) < 0)
-        return err;
 #endif
+    {
+        closeInput(& fmt_ctx);
+        return err;
+    }
 
     av_dump_format(fmt_ctx, 0, filename, 0);
     //
@@ -191,6 +218,7 @@ FFmpegVideoReader::openFile(const char *filename,
     if (m_videoStreamIndex < 0)
     {
         av_log(NULL, AV_LOG_WARNING, "Opened file has not video-streams");
+        closeInput(& fmt_ctx);
         return -1;
     }
     AVCodecContext *pCodecCtx = fmt_ctx->streams[m_videoStreamIndex]->codec;
@@ -198,6 +226,7 @@ FFmpegVideoReader::openFile(const char *filename,
     if (pCodecCtx->codec_id == AV_CODEC_ID_NONE)
     {
         av_log(NULL, AV_LOG_ERROR, "Invalid video codec");
+        closeInput(& fmt_ctx);
         return -1;
     }
     AVCodec* codec = NULL;
@@ -260,6 +289,7 @@ FFmpegVideoReader::openFile(const char *filename,
 #endif
     {
         av_log(NULL, AV_LOG_ERROR, "Could not open the required codec for video");
+        closeInput(& fmt_ctx);
         return -1;
     }
 
@@ -267,6 +297,15 @@ FFmpegVideoReader::openFile(const char *filename,
     m_pSeekFrame = OSG_ALLOC_FRAME();
     m_pSrcFrame = OSG_ALLOC_FRAME();
     //
+    // Decoded frames of GOP-cache should not take more than 256 MB
+    //
+    const size_t            gopCacheBudget      = 256 * 1024 * 1024;
+    const int               decodedFrameSize    = avpicture_get_size(pCodecCtx->pix_fmt, pCodecCtx->width, pCodecCtx->height);
+    m_gopCacheMaxFrames = (decodedFrameSize > 0) ? gopCacheBudget / decodedFrameSize : 0;
+    m_gopCacheMaxFrames = std::min((size_t)120, std::max((size_t)8, m_gopCacheMaxFrames));
+    m_gopCacheIndex = 0;
+    m_preloadedPacketPos = 0;
+    //
     if (scaledWidth > 0)
     {
         m_new_width = scaledWidth;
@@ -327,6 +366,15 @@ FFmpegVideoReader::openFile(const char *filename,
 void
 FFmpegVideoReader::close(void)
 {
+    releaseGopCache();
+    releasePreloadedPackets();
+    // I/O thread should not touch demuxer after closing
+    if (m_prefetcher != NULL)
+    {
+        delete m_prefetcher;
+        m_prefetcher = NULL;
+    }
+
     if(m_packet.data != NULL)
     {
         av_free_packet(&m_packet);
@@ -359,6 +407,28 @@ FFmpegVideoReader::close(void)
 #endif
         m_fmt_ctx_ptr = NULL;
     }
+    // Custom IO context is not freed by demuxer
+    FFmpegMemorySource::closeContext(& m_ownContext);
+    if (m_pExtDecoder)
+    {
+        delete m_pExtDecoder;
+        m_pExtDecoder = NULL;
+    }
+}
+
+void
+FFmpegVideoReader::closeInput(AVFormatContext ** fmt_ctx)
+{
+// see: https://gitorious.org/ffmpeg/sastes-ffmpeg/commit/5266045
+// "add avformat_close_input()."
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(53, 17, 0)
+    avformat_close_input(fmt_ctx);
+#else
+    av_close_input_file(* fmt_ctx);
+    * fmt_ctx = NULL;
+#endif
+    // Custom IO context is not freed by demuxer
+    FFmpegMemorySource::closeContext(& m_ownContext);
     if (m_pExtDecoder)
     {
         delete m_pExtDecoder;
@@ -474,11 +544,10 @@ FFmpegVideoReader::get_duration(void) const
                         do
                         {
                             existRezult = true;
-                            const int readPacketRez = av_read_frame(m_fmt_ctx_ptr, & packet);
+                            const int readPacketRez = this_ptr->readPacket(& packet);
                             if(readPacketRez < 0)
                             {
-                                if (readPacketRez == static_cast<int>(AVERROR_EOF) ||
-                                    m_fmt_ctx_ptr->pb->eof_reached)
+                                if (this_ptr->isEndOfFile(readPacketRez))
                                 {
                                     // File(all streams) finished
                                 }
@@ -517,6 +586,143 @@ FFmpegVideoReader::get_duration(void) const
     return m_fmt_ctx_ptr->duration * 1000 / AV_TIME_BASE;   // milliseconds
 }
 
+const int
+FFmpegVideoReader::readVideoPacket(unsigned long & currPacketPos, const bool decodeTillMinReqTime, const double & minReqTimeMS)
+{
+    bool continue_read_packets = false;
+    //
+    // Read the next packet, skipping all packets that aren't for this stream
+    //
+    do
+    {
+        // Free old packet
+        if(m_packet.data != NULL)
+            av_free_packet(&m_packet);
+
+        // Read new packet
+        const int readPacketRez = readPacket(&m_packet);
+#ifdef FFMPEG_DEBUG
+        int64_t l_pts = m_packet.pts;
+        int64_t l_dts = m_packet.dts;
+        av_log(NULL, AV_LOG_DEBUG, "m_packet.pts = %lu; m_packet.dts = %lu; m_packet.pos = %lu;",
+            (int)l_pts,
+            (int)l_dts,
+            (int)m_packet.pos);
+#endif // FFMPEG_DEBUG
+        currPacketPos = m_packet.pos;
+        if(readPacketRez < 0)
+        {
+            if (isEndOfFile(readPacketRez))
+            {
+                // File(all streams) finished
+            }
+            else {
+                OSG_FATAL << "av_read_frame() returned " << AvStrError(readPacketRez) << std::endl;
+                throw std::runtime_error("av_read_frame() failed");
+            }
+
+            return readPacketRez;
+        }
+        continue_read_packets = false;
+        if (decodeTillMinReqTime == false) // Check condition for continue searching by min required time without decoding
+        {
+            if (m_packet.stream_index == m_videoStreamIndex && minReqTimeMS > 0.0)
+            {
+                if(m_packet.dts != AV_NOPTS_VALUE)
+                {
+                    const double frame_time_pos_ms = m_packet.dts * av_q2d(m_fmt_ctx_ptr->streams[m_videoStreamIndex]->time_base) * 1000;
+
+                    if (minReqTimeMS > 0.0 &&
+                        frame_time_pos_ms < minReqTimeMS)
+                    {
+                        continue_read_packets = true; // read next packet without decoding
+                    }
+                }
+            }
+        }
+    } while(m_packet.stream_index != m_videoStreamIndex || continue_read_packets);
+
+    return 0;
+}
+
+#ifdef OSG_SEND_RECEIVE_DECODE
+
+bool
+FFmpegVideoReader::GetNextFrame(AVCodecContext *pCodecCtx,
+                                AVFrame *pFrame,
+                                unsigned long & currPacketPos,
+                                double & currTime,
+                                const size_t & drop_frame_nb,
+                                const bool decodeTillMinReqTime,
+                                const double & minReqTimeMS)
+{
+    size_t                  drop_frame_counter = drop_frame_nb;
+    //
+    // First time we're called, set m_packet.data to NULL to indicate it
+    // doesn't have to be freed
+    //
+    if (m_FirstFrame)
+    {
+        m_FirstFrame = false;
+        m_packet.data = NULL;
+        m_bytesRemaining = 0;
+    }
+    //
+    // Receive frames till decoder asks for more packets.
+    // Decoder keeps references to sent data, so packet could be freed at any time after sending.
+    //
+    while (true)
+    {
+        const int   receiveRez = avcodec_receive_frame (pCodecCtx, pFrame);
+
+        if (receiveRez == 0)
+        {
+            // Presentation time of the frame. Decoder reorders frames, so it is not the time of the last packet.
+            double  pts = (pFrame->best_effort_timestamp != AV_NOPTS_VALUE) ? pFrame->best_effort_timestamp : 0;
+
+            pts *= av_q2d(m_fmt_ctx_ptr->streams[m_videoStreamIndex]->time_base);
+
+            if (decodeTillMinReqTime == true &&
+                (minReqTimeMS > 0 && pts*1000.0 < minReqTimeMS)) // should have (minReqTimeMS > 0) because pts could be negative
+            {
+                continue;
+            }
+#ifdef FFMPEG_DEBUG
+            av_log(NULL, AV_LOG_DEBUG, "pts: %f", pts);
+#endif // FFMPEG_DEBUG
+            currTime = pts;
+
+            if (drop_frame_counter == 0)
+                return true;
+
+            drop_frame_counter--;
+            continue;
+        }
+        // All frames have been drained at the end of file
+        if (receiveRez == static_cast<int>(AVERROR_EOF))
+            return false;
+
+        // Broken packet is skipped, so it does not finish the stream
+        if (receiveRez != AVERROR(EAGAIN))
+            av_log(NULL, AV_LOG_WARNING, "Error while decoding frame");
+
+        int         sendRez;
+        if (readVideoPacket(currPacketPos, decodeTillMinReqTime, minReqTimeMS) < 0)
+        {
+            // Empty packet switches decoder to draining of delayed frames
+            sendRez = avcodec_send_packet (pCodecCtx, NULL);
+        }
+        else
+        {
+            sendRez = avcodec_send_packet (pCodecCtx, & m_packet);
+        }
+        if (sendRez < 0 && sendRez != static_cast<int>(AVERROR_EOF))
+            av_log(NULL, AV_LOG_WARNING, "Error while sending packet to decoder");
+    }
+}
+
+#else // OSG_SEND_RECEIVE_DECODE
+
 bool
 FFmpegVideoReader::GetNextFrame(AVCodecContext *pCodecCtx,
                                 AVFrame *pFrame,
@@ -528,7 +734,6 @@ FFmpegVideoReader::GetNextFrame(AVCodecContext *pCodecCtx,
 {
     int                     bytesDecoded;
     int                     frameFinished;
-    bool                    isDecodedData   = false;
     double                  pts             = 0;
     size_t                  drop_frame_counter = drop_frame_nb;
     //
@@ -552,11 +757,12 @@ FFmpegVideoReader::GetNextFrame(AVCodecContext *pCodecCtx,
             // Decode the next chunk of data
             bytesDecoded = avcodec_decode_video2 (pCodecCtx, pFrame, & frameFinished, & m_packet);
 
-            // Was there an error?
+            // Was there an error? Broken packet is skipped, so it does not finish the stream
             if(bytesDecoded < 0)
             {
                 av_log(NULL, AV_LOG_WARNING, "Error while decoding frame");
-                return false;
+                m_bytesRemaining = 0;
+                break;
             }
             m_bytesRemaining -= bytesDecoded;
 
@@ -586,8 +792,6 @@ FFmpegVideoReader::GetNextFrame(AVCodecContext *pCodecCtx,
 
                 pts *= av_q2d(m_fmt_ctx_ptr->streams[m_videoStreamIndex]->time_base);
 
-                isDecodedData = true;
-
                 continue_read_packets = false;
                 if (decodeTillMinReqTime == true &&
                     (minReqTimeMS > 0 && pts*1000.0 < minReqTimeMS)) // should have (minReqTimeMS > 0) because pts could be negative
@@ -610,106 +814,64 @@ FFmpegVideoReader::GetNextFrame(AVCodecContext *pCodecCtx,
             }
         }
 
-        // Read the next packet, skipping all packets that aren't for this
-        // stream
-        continue_read_packets = false;
-        do
-        {
-            // Free old packet
-            if(m_packet.data != NULL)
-                av_free_packet(&m_packet);
-
-            // Read new packet
-            const int readPacketRez = av_read_frame(m_fmt_ctx_ptr, &m_packet);
-#ifdef FFMPEG_DEBUG
-            int64_t l_pts = m_packet.pts;
-            int64_t l_dts = m_packet.dts;
-            av_log(NULL, AV_LOG_DEBUG, "m_packet.pts = %lu; m_packet.dts = %lu; m_packet.pos = %lu;",
-                (int)l_pts,
-                (int)l_dts,
-                (int)m_packet.pos);
-#endif // FFMPEG_DEBUG
-            currPacketPos = m_packet.pos;
-            if(readPacketRez < 0)
-            {
-                if (readPacketRez == static_cast<int>(AVERROR_EOF) ||
-                    m_fmt_ctx_ptr->pb->eof_reached)
-                {
-                    // File(all streams) finished
-                }
-                else {
-                    OSG_FATAL << "av_read_frame() returned " << AvStrError(readPacketRez) << std::endl;
-                    throw std::runtime_error("av_read_frame() failed");
-                }
-
-                goto loop_exit;
-            }
-            continue_read_packets = false;
-            if (decodeTillMinReqTime == false) // Check condition for continue searching by min required time without decoding
-            {
-                if (m_packet.stream_index == m_videoStreamIndex && minReqTimeMS > 0.0)
-                {
-                    if(m_packet.dts != AV_NOPTS_VALUE)
-                    {
-                        const double frame_time_pos_ms = m_packet.dts * av_q2d(m_fmt_ctx_ptr->streams[m_videoStreamIndex]->time_base) * 1000;
-
-                        if (minReqTimeMS > 0.0 &&
-                            frame_time_pos_ms < minReqTimeMS)
-                        {
-                            continue_read_packets = true; // read next packet without decoding
-                        }
-                    }
-                }
-            }
-        } while(m_packet.stream_index != m_videoStreamIndex || continue_read_packets);
+        // Read the next packet of this stream
+        if (readVideoPacket(currPacketPos, decodeTillMinReqTime, minReqTimeMS) < 0)
+            goto loop_exit;
 
         m_bytesRemaining = m_packet.size;
     }
 
 loop_exit:
+    //
+    // Codec delays frames(B-frames, frame threading), so at the end of file empty packet
+    // is decoded till no more frames come out. After the last frame next call comes here
+    // again and codec reports no frame, so the end of stream is reported only when all frames are delivered.
+    //
+    av_init_packet(& m_packet);
+    m_packet.data = NULL;
+    m_packet.size = 0;
 
-    // Decode the rest of the last frame
-    bytesDecoded = avcodec_decode_video2(pCodecCtx, pFrame, &frameFinished, &m_packet);
-
-    if (bytesDecoded > 0)
+    while (true)
     {
-        if(m_packet.dts == AV_NOPTS_VALUE &&
-            pFrame->opaque && *(uint64_t*)pFrame->opaque != AV_NOPTS_VALUE)
-        {
+        bytesDecoded = avcodec_decode_video2(pCodecCtx, pFrame, &frameFinished, &m_packet);
+
+        if (bytesDecoded < 0 || frameFinished == 0)
+            return false;
+        //
+        // Empty packet has no time, so it is taken from the frame
+        //
+#ifdef OSG_BEST_EFFORT_TIMESTAMP
+        if (pFrame->best_effort_timestamp != AV_NOPTS_VALUE)
+            pts = pFrame->best_effort_timestamp;
+        else
+#endif // OSG_BEST_EFFORT_TIMESTAMP
+#if LIBAVCODEC_VERSION_MAJOR >= 53
+        if (pFrame->pkt_pts != AV_NOPTS_VALUE)
+            pts = pFrame->pkt_pts;
+        else
+#endif
+        if (pFrame->opaque && *(uint64_t*)pFrame->opaque != AV_NOPTS_VALUE)
             pts = *(uint64_t *)pFrame->opaque;
-        }
         else
+            pts = 0;
+        pts *= av_q2d(m_fmt_ctx_ptr->streams[m_videoStreamIndex]->time_base);
+
+        if (decodeTillMinReqTime == true &&
+            (minReqTimeMS > 0 && pts*1000.0 < minReqTimeMS))
         {
-            if(m_packet.dts != AV_NOPTS_VALUE)
-            {
-                pts = m_packet.dts;
-            }
-            else
-            {
-                pts = 0;
-            }
+            continue;
         }
-        pts *= av_q2d(m_fmt_ctx_ptr->streams[m_videoStreamIndex]->time_base);
-        //
-        m_bytesRemaining -= bytesDecoded;
-        isDecodedData = true;
-    }
-    // Free last packet
-    if(m_packet.data!=NULL)
-        av_free_packet(&m_packet);
+        currTime = pts;
 
-    if (isDecodedData == false)
-        frameFinished = 0;
+        if (drop_frame_counter == 0)
+            return true;
 
-    // Did we finish the current frame? Then we can return
-    if(frameFinished!=0)
-    {
-        currTime = pts;
+        drop_frame_counter--;
     }
-
-    return frameFinished != 0;
 }
 
+#endif // OSG_SEND_RECEIVE_DECODE
+
 int
 FFmpegVideoReader::grabNextFrame(uint8_t * buffer, double & timeStampInSec, const size_t & drop_frame_nb, const bool decodeTillMinReqTime, const double & minReqTimeMS)
 {
@@ -721,6 +883,8 @@ FFmpegVideoReader::grabNextFrame(uint8_t * buffer, double & timeStampInSec, cons
     {
         return -1;
     }
+    // Codec leaves position of the frame-stepping
+    releaseGopCache();
     pFrameRGB->width = m_new_width;
     pFrameRGB->height = m_new_height;
     //
@@ -780,6 +944,492 @@ av_log(NULL, AV_LOG_DEBUG, "GetNextFrame + sws_scale spent %3d %3d ms Time: %4d
     return rezValue;
 }
 
+int
+FFmpegVideoReader::grabPrevFrame(uint8_t * buffer, double & timeStampInSec, const double & beforeTimeMS)
+{
+    if (beforeTimeMS <= 0.0)
+        return -1;
+
+#ifdef OSG_CLONE_FRAME
+    const double        frameMS         = 1000.0 / get_fps();
+    //
+    // GOP is decoded forward once into GOP-cache, then its frames are returned from the cache in reverse order.
+    // Cache is refilled by the previous GOP only when its first frame has been returned.
+    //
+    for (int attempt = 0; attempt < 2; ++attempt)
+    {
+        size_t          index           = m_gopCache.size();
+
+        while (index > 0 && m_gopCache[index - 1].Time * 1000.0 >= beforeTimeMS)
+            --index;
+        //
+        // Found frame is the previous one only when cache also contains frame displayed at [beforeTimeMS]
+        //
+        if (index > 0 &&
+            (index < m_gopCache.size() || m_gopCache.back().Time * 1000.0 + frameMS * 1.5 >= beforeTimeMS))
+        {
+            m_gopCacheIndex = index - 1;
+            timeStampInSec = m_gopCache[m_gopCacheIndex].Time;
+
+            return ConvertToRGB(m_gopCache[m_gopCacheIndex].Frame, buffer, NULL);
+        }
+
+        if (fillGopCache(std::max(0.0, beforeTimeMS - frameMS)) < 0)
+            return -1;
+    }
+    return -1;
+#else
+    AVCodecContext *    pCodecCtx       = m_fmt_ctx_ptr->streams[m_videoStreamIndex]->codec;
+    const int64_t       start_time      = (m_fmt_ctx_ptr->start_time != AV_NOPTS_VALUE) ? m_fmt_ctx_ptr->start_time : 0;
+    double              stepBackMS      = 1000.0 / get_fps();
+    //
+    // Decoded frames could not be kept by this version of libavcodec, so go-back by key-frames
+    // with growing step till seek found key-frame before required time
+    //
+    while (true)
+    {
+        const double    targetMS        = std::max(0.0, beforeTimeMS - stepBackMS);
+        const int64_t   seek_target     = av_rescale_q ((int64_t)(targetMS * (AV_TIME_BASE / 1000)) + start_time,
+                                                        osg_get_time_base_q(),
+                                                        m_fmt_ctx_ptr->streams[m_videoStreamIndex]->time_base);
+        m_FirstFrame = true;
+
+        if (seekPacket (seek_target, AVSEEK_FLAG_BACKWARD) < 0)
+        {
+            av_log(NULL, AV_LOG_ERROR, "Cannot seek video frame");
+            return -1;
+        }
+        avcodec_flush_buffers(pCodecCtx);
+
+        unsigned long   packetPos;
+        double          frameTime;
+        if (GetNextFrame(pCodecCtx, m_pSrcFrame, packetPos, frameTime) == false)
+            return -1;
+
+        if (frameTime * 1000.0 < beforeTimeMS)
+        {
+            timeStampInSec = frameTime;
+            return ConvertToRGB(m_pSrcFrame, buffer, NULL);
+        }
+        //
+        // Start of the stream reached, but required frame has not been found
+        //
+        if (targetMS <= 0.0)
+            return -1;
+
+        stepBackMS *= 2.0;
+    }
+#endif
+}
+
+void
+FFmpegVideoReader::setKeyFramesOnly(const bool value)
+{
+    AVCodecContext *    pCodecCtx = m_fmt_ctx_ptr->streams[m_videoStreamIndex]->codec;
+
+    pCodecCtx->skip_frame = value ? AVDISCARD_NONKEY : AVDISCARD_DEFAULT;
+}
+
+void
+FFmpegVideoReader::releaseGopCache()
+{
+    for (size_t i = 0; i < m_gopCache.size(); ++i)
+    {
+        OSG_FREE_FRAME (& m_gopCache[i].Frame);
+    }
+    m_gopCache.clear();
+    m_gopCacheIndex = 0;
+}
+
+void
+FFmpegVideoReader::releasePreloadedPackets()
+{
+    for (size_t i = 0; i < m_preloadedPackets.size(); ++i)
+    {
+        av_free_packet(& m_preloadedPackets[i]);
+    }
+    m_preloadedPackets.clear();
+    m_preloadedPacketPos = 0;
+}
+
+const int
+FFmpegVideoReader::readPacket(AVPacket * packet)
+{
+    if (m_preloadedPackets.empty())
+        return (m_prefetcher != NULL) ? m_prefetcher->readFrame(packet) : av_read_frame(m_fmt_ctx_ptr, packet);
+
+    if (m_preloadedPacketPos >= m_preloadedPackets.size())
+        return AVERROR_EOF;
+    const AVPacket &    src = m_preloadedPackets[m_preloadedPacketPos++];
+#ifdef OSG_REF_PACKET
+    //
+    // Caller frees its reference only, so data of preloaded packet is shared
+    //
+    return OSG_REF_PACKET(packet, & src);
+#else
+    //
+    // Decoder gets own copy of data, because caller frees packet
+    //
+    if (av_new_packet(packet, src.size) < 0)
+        return AVERROR(ENOMEM);
+
+    memcpy(packet->data, src.data, src.size);
+    packet->pts             = src.pts;
+    packet->dts             = src.dts;
+    packet->pos             = src.pos;
+    packet->duration        = src.duration;
+    packet->flags           = src.flags;
+    packet->stream_index    = src.stream_index;
+
+    return 0;
+#endif
+}
+
+const bool
+FFmpegVideoReader::isEndOfFile(const int readRez) const
+{
+    if (readRez == static_cast<int>(AVERROR_EOF))
+        return true;
+    // I/O thread of prefetcher writes context of the demuxer
+    if (m_prefetcher != NULL)
+        return m_prefetcher->isEndOfFile();
+
+    return m_fmt_ctx_ptr->pb && m_fmt_ctx_ptr->pb->eof_reached;
+}
+
+const int
+FFmpegVideoReader::seekPacket(const int64_t & seek_target, const int flags)
+{
+    if (m_preloadedPackets.empty())
+    {
+        return (m_prefetcher != NULL) ?
+                m_prefetcher->seekFrame(m_videoStreamIndex, seek_target, flags) :
+                av_seek_frame(m_fmt_ctx_ptr, m_videoStreamIndex, seek_target, flags);
+    }
+    //
+    // Packets are in decoding order. Search the last key-frame before the target(backward)
+    // or the first key-frame after the target. Target before the first key-frame seeks the start.
+    //
+    const bool          anyFrame    = (flags & AVSEEK_FLAG_ANY) != 0;
+    const bool          backward    = (flags & AVSEEK_FLAG_BACKWARD) != 0;
+    size_t              first       = m_preloadedPackets.size();
+    size_t              found       = m_preloadedPackets.size();
+
+    for (size_t i = 0; i < m_preloadedPackets.size(); ++i)
+    {
+        const AVPacket &    packet  = m_preloadedPackets[i];
+        const int64_t       ts      = (packet.pts != AV_NOPTS_VALUE) ? packet.pts : packet.dts;
+
+        if (anyFrame == false && (packet.flags & AV_PKT_FLAG_KEY) == 0)
+            continue;
+
+        if (first == m_preloadedPackets.size())
+            first = i;
+
+        if (backward)
+        {
+            if (ts <= seek_target)
+                found = i;
+        }
+        else if (ts >= seek_target)
+        {
+            found = i;
+            break;
+        }
+    }
+    if (found == m_preloadedPackets.size())
+    {
+        if (backward == false || first == m_preloadedPackets.size())
+            return -1;
+        found = first;
+    }
+    m_preloadedPacketPos = found;
+
+    return 0;
+}
+
+const int
+FFmpegVideoReader::preload(const size_t & maxBytes)
+{
+    std::vector<AVPacket>   packets;
+    size_t                  bytes = 0;
+    int                     err = 0;
+    const int64_t           start_time = (m_fmt_ctx_ptr->start_time != AV_NOPTS_VALUE) ? m_fmt_ctx_ptr->start_time : 0;
+
+    if (m_preloadedPackets.empty() == false)
+        return 0;
+    // Demuxer read by prefetcher could not be read here
+    if (m_prefetcher != NULL)
+        return -1;
+
+    if (av_seek_frame(m_fmt_ctx_ptr, -1, start_time, AVSEEK_FLAG_BACKWARD) < 0)
+        return -1;
+
+    while (true)
+    {
+        AVPacket    packet;
+
+        av_init_packet(& packet);
+        packet.data = NULL;
+        packet.size = 0;
+
+        err = av_read_frame(m_fmt_ctx_ptr, & packet);
+        if (err < 0)
+        {
+            if (err == static_cast<int>(AVERROR_EOF) || m_fmt_ctx_ptr->pb->eof_reached)
+                err = 0;
+            break;
+        }
+        if (packet.stream_index != m_videoStreamIndex)
+        {
+            av_free_packet(& packet);
+            continue;
+        }
+        bytes += packet.size;
+        if (bytes > maxBytes)
+        {
+            av_free_packet(& packet);
+            err = -1;
+            break;
+        }
+#ifdef OSG_REF_PACKET
+        //
+        // Packet should own reference-counted data, which is shared with decoder by readPacket()
+        //
+        AVPacket    owned;
+
+        av_init_packet(& owned);
+        owned.data = NULL;
+        owned.size = 0;
+
+        err = OSG_REF_PACKET(& owned, & packet);
+        av_free_packet(& packet);
+        if (err < 0)
+            break;
+
+        packets.push_back(owned);
+#else
+        // Packet should own its data, because demuxer reuses its buffers
+        av_dup_packet(& packet);
+        packets.push_back(packet);
+#endif
+    }
+    //
+    // Clip is too large or broken, so it is still read from the file
+    //
+    if (err < 0 || packets.empty())
+    {
+        for (size_t i = 0; i < packets.size(); ++i)
+            av_free_packet(& packets[i]);
+
+        av_seek_frame(m_fmt_ctx_ptr, -1, start_time, AVSEEK_FLAG_BACKWARD);
+        avcodec_flush_buffers(m_fmt_ctx_ptr->streams[m_videoStreamIndex]->codec);
+        m_FirstFrame = true;
+
+        return -1;
+    }
+    m_preloadedPackets.swap(packets);
+    m_preloadedPacketPos = 0;
+
+    avcodec_flush_buffers(m_fmt_ctx_ptr->streams[m_videoStreamIndex]->codec);
+    m_FirstFrame = true;
+
+    av_log(NULL, AV_LOG_INFO, "Preloaded %d video packets, %d bytes", (int)m_preloadedPackets.size(), (int)bytes);
+
+    return 0;
+}
+
+const int
+FFmpegVideoReader::prefetch(const size_t & maxBytes, const double & maxDurationMS)
+{
+    // Preloaded packets do not read the file
+    if (m_preloadedPackets.empty() == false)
+        return -1;
+
+    if (m_prefetcher == NULL)
+    {
+        m_prefetcher = new FFmpegPacketPrefetcher(m_fmt_ctx_ptr, std::vector<int>(1, m_videoStreamIndex), maxBytes, maxDurationMS);
+        m_prefetcher->Start();
+    }
+    return 0;
+}
+
+const int
+FFmpegVideoReader::getPrefetchStats(FFmpegPacketPrefetcher::Stats & stats) const
+{
+    if (m_prefetcher == NULL)
+        return -1;
+
+    stats = m_prefetcher->getStats();
+    return 0;
+}
+
+const int
+FFmpegVideoReader::pushGopCache(AVFrame * pFrame, const double & frameTime)
+{
+#ifdef OSG_CLONE_FRAME
+    CachedFrame         cached;
+
+    cached.Frame = OSG_CLONE_FRAME(pFrame);
+    cached.Time = frameTime;
+
+    if (cached.Frame == NULL)
+    {
+        av_log(NULL, AV_LOG_ERROR, "Cannot keep decoded frame in GOP-cache");
+        return -1;
+    }
+    m_gopCache.push_back(cached);
+    //
+    // Oldest frames are dropped when cache exceeds memory limit
+    //
+    while (m_gopCache.size() > m_gopCacheMaxFrames)
+    {
+        OSG_FREE_FRAME (& m_gopCache.front().Frame);
+        m_gopCache.pop_front();
+    }
+    m_gopCacheIndex = m_gopCache.size() - 1;
+
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+const int
+FFmpegVideoReader::fillGopCache(const double & targetMS)
+{
+    AVCodecContext *    pCodecCtx       = m_fmt_ctx_ptr->streams[m_videoStreamIndex]->codec;
+    const int64_t       start_time      = (m_fmt_ctx_ptr->start_time != AV_NOPTS_VALUE) ? m_fmt_ctx_ptr->start_time : 0;
+    const double        halfFrameMS     = 500.0 / get_fps();
+    double              stepBackMS      = 0.0;
+
+    releaseGopCache();
+    //
+    // Seek to key-frame before required time. Go-back with growing step if seek found key-frame after it.
+    //
+    while (true)
+    {
+        const double    seekMS          = std::max(0.0, targetMS - stepBackMS);
+        const int64_t   seek_target     = av_rescale_q ((int64_t)(seekMS * (AV_TIME_BASE / 1000)) + start_time,
+                                                        osg_get_time_base_q(),
+                                                        m_fmt_ctx_ptr->streams[m_videoStreamIndex]->time_base);
+        m_FirstFrame = true;
+
+        if (seekPacket (seek_target, AVSEEK_FLAG_BACKWARD) < 0)
+        {
+            av_log(NULL, AV_LOG_ERROR, "Cannot seek video frame");
+            return -1;
+        }
+        avcodec_flush_buffers(pCodecCtx);
+
+        unsigned long   packetPos;
+        double          frameTime;
+        if (GetNextFrame(pCodecCtx, m_pSrcFrame, packetPos, frameTime) == false)
+            return -1;
+
+        if (frameTime * 1000.0 > targetMS + halfFrameMS && seekMS > 0.0)
+        {
+            stepBackMS = (stepBackMS > 0.0) ? stepBackMS * 2.0 : halfFrameMS * 2.0;
+            continue;
+        }
+        if (pushGopCache(m_pSrcFrame, frameTime) < 0)
+            return -1;
+        //
+        // Decode and keep all frames till the frame, which is displayed at required time
+        //
+        while (frameTime * 1000.0 < targetMS - halfFrameMS)
+        {
+            // End of stream: last decoded frame is displayed
+            if (GetNextFrame(pCodecCtx, m_pSrcFrame, packetPos, frameTime) == false)
+                break;
+
+            if (pushGopCache(m_pSrcFrame, frameTime) < 0)
+                return -1;
+        }
+        return 0;
+    }
+}
+
+int
+FFmpegVideoReader::stepFrame(const int direction, const double & fromTimeMS, unsigned char * ptrRGBmap, double & timeStampInSec)
+{
+    if (ptrRGBmap == NULL || direction == 0)
+    {
+        return -1;
+    }
+#ifdef OSG_CLONE_FRAME
+    AVCodecContext *    pCodecCtx       = m_fmt_ctx_ptr->streams[m_videoStreamIndex]->codec;
+    const double        halfFrameMS     = 500.0 / get_fps();
+    //
+    // Cache is valid only when its current frame is the frame displayed at [fromTimeMS]
+    //
+    if (m_gopCache.empty() ||
+        fabs(m_gopCache[m_gopCacheIndex].Time * 1000.0 - fromTimeMS) > halfFrameMS)
+    {
+        if (fillGopCache(fromTimeMS) < 0)
+            return -1;
+    }
+
+    if (direction > 0)
+    {
+        if (m_gopCacheIndex + 1 < m_gopCache.size())
+        {
+            m_gopCacheIndex++;
+        }
+        else
+        {
+            // Last cached frame is the last decoded one, so just continue decoding
+            unsigned long   packetPos;
+            double          frameTime;
+            if (GetNextFrame(pCodecCtx, m_pSrcFrame, packetPos, frameTime) == false)
+                return -1;
+
+            if (pushGopCache(m_pSrcFrame, frameTime) < 0)
+                return -1;
+        }
+    }
+    else
+    {
+        if (m_gopCacheIndex > 0)
+        {
+            m_gopCacheIndex--;
+        }
+        else
+        {
+            //
+            // Current frame is the first cached one. Cache should be refilled by the previous GOP.
+            //
+            const double    frontTimeMS     = m_gopCache.front().Time * 1000.0;
+
+            if (frontTimeMS < halfFrameMS)
+                return -1;
+
+            if (fillGopCache(frontTimeMS - halfFrameMS * 2.0) < 0)
+                return -1;
+
+            if (m_gopCache[m_gopCacheIndex].Time * 1000.0 >= frontTimeMS)
+                return -1;
+        }
+    }
+
+    timeStampInSec = m_gopCache[m_gopCacheIndex].Time;
+
+    return ConvertToRGB(m_gopCache[m_gopCacheIndex].Frame, NULL, ptrRGBmap);
+#else
+    //
+    // Decoded frames could not be kept by this version of libavcodec, so step by accurate seek
+    //
+    const double        targetMS        = fromTimeMS + direction * 1000.0 / get_fps();
+
+    if (targetMS < 0.0)
+        return -1;
+
+    timeStampInSec = targetMS / 1000.0;
+
+    return seek((int64_t)targetMS, ptrRGBmap);
+#endif
+}
+
 int
 FFmpegVideoReader::fast_nonaccurate_seek(int64_t & timestamp/*milliseconds*/, unsigned char * ptrRGBmap)
 {
@@ -788,6 +1438,7 @@ FFmpegVideoReader::fast_nonaccurate_seek(int64_t & timestamp/*milliseconds*/, un
         return -1;
     }
 
+    releaseGopCache();
     //
     // convert to AV_TIME_BASE
     //
@@ -805,10 +1456,8 @@ FFmpegVideoReader::fast_nonaccurate_seek(int64_t & timestamp/*milliseconds*/, un
 
     m_FirstFrame = true;
 
-    int             retValueSeekFrame = av_seek_frame ( m_fmt_ctx_ptr,
-                                                        m_videoStreamIndex,
-                                                        seek_target,
-                                                        AVSEEK_FLAG_BACKWARD);
+    int             retValueSeekFrame = seekPacket ( seek_target,
+                                                    AVSEEK_FLAG_BACKWARD);
     if (retValueSeekFrame >= 0)
     {
         unsigned long       packetPosLoop;
@@ -837,6 +1486,7 @@ FFmpegVideoReader::seek(int64_t timestamp/*milliseconds*/, unsigned char * ptrRG
         return -1;
     }
 
+    releaseGopCache();
     //
     // convert to AV_TIME_BASE
     //
@@ -855,17 +1505,15 @@ FFmpegVideoReader::seek(int64_t timestamp/*milliseconds*/, unsigned char * ptrRG
 
     m_FirstFrame = true;
 
-    int             retValueSeekFrame = av_seek_frame ( m_fmt_ctx_ptr,
-                                                        m_videoStreamIndex,
-                                                        seek_target,
-                                                        AVSEEK_FLAG_BACKWARD);
+    int             retValueSeekFrame = seekPacket ( seek_target,
+                                                    AVSEEK_FLAG_BACKWARD);
     //
     // Try to resolve TROUBLE by seeking with other flags.
     // When I want seek(0), AVSEEK_FLAG_BACKWARD returns ERROR, but AVSEEK_FLAG_ANY returns OK but not
     // actual time(not 0 but 0.0xx). It is better than nothing.
     //
     if (retValueSeekFrame < 0)
-         retValueSeekFrame = av_seek_frame(m_fmt_ctx_ptr, m_videoStreamIndex, seek_target, AVSEEK_FLAG_ANY);
+         retValueSeekFrame = seekPacket(seek_target, AVSEEK_FLAG_ANY);
 
     if (retValueSeekFrame >= 0)
     {
@@ -889,7 +1537,7 @@ FFmpegVideoReader::seek(int64_t timestamp/*milliseconds*/, unsigned char * ptrRG
                 seek_target -= av_rescale_q(AV_TIME_BASE * 0.1,
                                             osg_get_time_base_q(),
                                             m_fmt_ctx_ptr->streams[m_videoStreamIndex]->time_base);
-                av_seek_frame(m_fmt_ctx_ptr, m_videoStreamIndex, seek_target, AVSEEK_FLAG_BACKWARD);
+                seekPacket(seek_target, AVSEEK_FLAG_BACKWARD);
                 bSuccess = GetNextFrame(pCodecCtx, m_pSeekFrame, packetPosLoop, timeLoop);
                 timeLoopPrev = timeLoop;
             }
@@ -19,6 +19,9 @@
 
 #include "FFmpegHeaders.hpp"
 #include "FFmpegIExternalDecoder.hpp"
+#include "FFmpegPacketPrefetcher.hpp"
+#include <deque>
+#include <vector>
 
 namespace osgFFmpeg {
 
@@ -27,6 +30,11 @@ class FFmpegParameters;
 class FFmpegVideoReader
 {
 private:
+    struct CachedFrame
+    {
+        AVFrame *       Frame;
+        double          Time;   // Time in seconds
+    };
     bool                m_FirstFrame;
     int                 m_bytesRemaining;
 #ifdef USE_SWSCALE
@@ -47,6 +55,34 @@ private:
     unsigned int        m_new_width;
     unsigned int        m_new_height;
 
+    // Decoded frames(GOP) around current position of frame-stepping.
+    // Last cached frame is always the last frame decoded by codec, so stepping forward continues decoding from it.
+    std::deque<CachedFrame> m_gopCache;
+    size_t              m_gopCacheIndex;    // index of current frame in \m_gopCache
+    size_t              m_gopCacheMaxFrames;
+    void                releaseGopCache();
+    // Decode frames from the key-frame till frame with time [targetMS]
+    const int           fillGopCache(const double & targetMS);
+    const int           pushGopCache(AVFrame * pFrame, const double & frameTime);
+
+    // Compressed packets of the video stream, preloaded at open. If empty, packets are read from the file.
+    std::vector<AVPacket>   m_preloadedPackets;
+    size_t              m_preloadedPacketPos;   // index of the next packet read from \m_preloadedPackets
+    FFmpegPacketPrefetcher * m_prefetcher;      // reads the file ahead. NULL if file is read directly
+    AVIOContext *       m_ownContext;           // IO context of memory source or memory-mapped file. NULL if file is opened by demuxer
+    void                releasePreloadedPackets();
+    // Close demuxer and own IO context, if opening of the file fails after the demuxer is opened
+    void                closeInput(AVFormatContext ** fmt_ctx);
+    // Read next packet from preloaded packets or from the file. Returns value as av_read_frame() does
+    const int           readPacket(AVPacket * packet);
+    // True if [readRez] returned by readPacket() is caused by end of file
+    const bool          isEndOfFile(const int readRez) const;
+    // Seek preloaded packets or the file. Parameters and returned value are as av_seek_frame() has
+    const int           seekPacket(const int64_t & seek_target, const int flags);
+    // Read next packet of the video stream to \m_packet. If [decodeTillMinReqTime] is false, packets before
+    // [minReqTimeMS] are skipped. Returns negative value at the end of file.
+    const int           readVideoPacket(unsigned long & currPacketPos, const bool decodeTillMinReqTime, const double & minReqTimeMS);
+
     // - [minReqTimeMS] - if greater than 0, it is minimal time which will be searched to return frame.
     //  If negative, then next frame will be returned. Another words, if [minReqTimeMS]>=0, then [timeStampInSec]
     //  will be eq or greater than [minReqTimeMS]
@@ -67,11 +103,25 @@ public:
     /*fast seek may find keyframe, but not asked time and little less than ask*/
     int                 fast_nonaccurate_seek(int64_t & timestamp/*milliseconds*/, unsigned char * ptrRGBmap);
     int                 seek(int64_t timestamp, unsigned char * ptrRGBmap);
+    // Read all packets of the video stream into memory, if they take no more than [maxBytes].
+    // After that file is not read anymore, and seeking does not touch the file.
+    const int           preload(const size_t & maxBytes);
+    // Read packets of the video stream ahead by I/O thread. Queue is limited by [maxBytes] and [maxDurationMS].
+    const int           prefetch(const size_t & maxBytes, const double & maxDurationMS);
+    const int           getPrefetchStats(FFmpegPacketPrefetcher::Stats & stats) const;
     // buffer-size should be width*height*3 bytes;
     // - [minReqTimeMS] - if greater than 0, it is minimal time which will be searched to return frame.
     //  If negative, then next frame will be returned. Another words, if [minReqTimeMS]>=0, then [timeStampInSec]
     //  will be eq or greater than [minReqTimeMS]
     int                 grabNextFrame(uint8_t * buffer, double & timeStampInSec, const size_t & drop_frame_nb, const bool decodeTillMinReqTime = true, const double & minReqTimeMS = -1.0);
+    // Grab nearest frame which time is less than [beforeTimeMS]. Used by reverse playback.
+    // buffer-size should be width*height*3 bytes;
+    int                 grabPrevFrame(uint8_t * buffer, double & timeStampInSec, const double & beforeTimeMS);
+    // If true, decoder skips all non-key frames. Used by fast playback.
+    void                setKeyFramesOnly(const bool value);
+    // Move exactly one frame forward([direction] > 0) or backward([direction] < 0) from frame displayed at [fromTimeMS].
+    // buffer-size should be width*height*3 bytes;
+    int                 stepFrame(const int direction, const double & fromTimeMS, unsigned char * ptrRGBmap, double & timeStampInSec);
     //
     //
     //
@@ -247,6 +247,118 @@ FFmpegWrapper::getNextImage(const long indexFile, unsigned char * bufRGB24, doub
     }
     return ret_value;
 }
+
+const short
+FFmpegWrapper::getPrevImage(const long indexFile, unsigned char * bufRGB24, double & timeStampInSec, const double beforeTimeMS)
+{
+    short ret_value = -1;
+    try
+    {
+        if (checkIndexVideoValid(indexFile) == 0 && bufRGB24 != NULL)
+        {
+            ret_value = g_openedVideoFiles[indexFile]->grabPrevFrame(bufRGB24, timeStampInSec, beforeTimeMS);
+        }
+    }
+    catch (...)
+    {
+        ret_value = -1;
+    }
+    return ret_value;
+}
+
+const short
+FFmpegWrapper::setVideoKeyFramesOnly(const long indexFile, const bool keyFramesOnly)
+{
+    short ret_value = -1;
+    try
+    {
+        if (checkIndexVideoValid(indexFile) == 0)
+        {
+            g_openedVideoFiles[indexFile]->setKeyFramesOnly(keyFramesOnly);
+            ret_value = 0;
+        }
+    }
+    catch (...)
+    {
+        ret_value = -1;
+    }
+    return ret_value;
+}
+
+const short
+FFmpegWrapper::preloadVideo(const long indexFile, const size_t maxBytes)
+{
+    short ret_value = -1;
+    try
+    {
+        if (checkIndexVideoValid(indexFile) == 0)
+        {
+            if (g_openedVideoFiles[indexFile]->preload(maxBytes) >= 0)
+                ret_value = 0;
+        }
+    }
+    catch (...)
+    {
+        ret_value = -1;
+    }
+    return ret_value;
+}
+
+const short
+FFmpegWrapper::prefetchVideo(const long indexFile, const size_t maxBytes, const double maxDurationMS)
+{
+    short ret_value = -1;
+    try
+    {
+        if (checkIndexVideoValid(indexFile) == 0 && maxBytes > 0 && maxDurationMS > 0.0)
+        {
+            if (g_openedVideoFiles[indexFile]->prefetch(maxBytes, maxDurationMS) >= 0)
+                ret_value = 0;
+        }
+    }
+    catch (...)
+    {
+        ret_value = -1;
+    }
+    return ret_value;
+}
+
+const short
+FFmpegWrapper::getVideoPrefetchStats(const long indexFile, FFmpegPacketPrefetcher::Stats & stats)
+{
+    short ret_value = -1;
+    try
+    {
+        if (checkIndexVideoValid(indexFile) == 0)
+        {
+            if (g_openedVideoFiles[indexFile]->getPrefetchStats(stats) >= 0)
+                ret_value = 0;
+        }
+    }
+    catch (...)
+    {
+        ret_value = -1;
+    }
+    return ret_value;
+}
+
+const short
+FFmpegWrapper::stepImage(const long indexFile, const int direction, const double fromTimeMS, unsigned char * bufRGB24, double & timeStampInSec)
+{
+    short ret_value = -1;
+    try
+    {
+        if (checkIndexVideoValid(indexFile) == 0 && bufRGB24 != NULL)
+        {
+            ret_value = g_openedVideoFiles[indexFile]->stepFrame(direction, fromTimeMS, bufRGB24, timeStampInSec);
+        }
+    }
+    catch (...)
+    {
+        ret_value = -1;
+    }
+    return ret_value;
+}
 /// ====================================================================================
 /// Reading audio
 /// ====================================================================================
@@ -342,6 +454,75 @@ FFmpegWrapper::openAudio(const char * pFileName, FFmpegParameters * parameters)
     return ret_falue;
 }
 
+const long
+FFmpegWrapper::openAudioTrack(const long indexFile, const int audioStreamNb)
+{
+    long ret_falue = -3;
+    if (checkIndexAudioValid(indexFile) != 0)
+        return -1;
+
+    FFMPEGAUDIOREADER* media = new FFMPEGAUDIOREADER;
+    try
+    {
+        if (media->openTrack(g_openedAudioFiles[indexFile], audioStreamNb) == 0)
+        {
+            //
+            // Initialize \media
+            //
+            media->seek(0);
+
+            unsigned long   startTimeMS;
+            AVSampleFormat  output_sampleFormat;
+            unsigned short  output_FrameRate;
+            unsigned long   samplesNb;
+            FFMPEGAUDIOREADER::getSamples(media,
+                                            startTimeMS,
+                                            0,
+                                            output_sampleFormat,
+                                            output_FrameRate,
+                                            samplesNb,
+                                            NULL,
+                                            -1.0);
+
+            const long maxIndexAudioFiles = g_maxIndexAudioFiles;
+
+            g_openedAudioFiles[maxIndexAudioFiles] = media;
+
+            ++g_maxIndexAudioFiles;
+            ret_falue = maxIndexAudioFiles;
+        }
+    }
+    catch (...)
+    {
+        ret_falue = -2;
+    }
+
+    if (ret_falue < 0)
+        delete media;
+
+    return ret_falue;
+}
+
+const int
+FFmpegWrapper::getAudioStreamNb(const long indexFile)
+{
+    int rez_value = -1;
+    try
+    {
+        if (checkIndexAudioValid(indexFile) == 0)
+        {
+            FFMPEGAUDIOREADER* media = g_openedAudioFiles[indexFile];
+
+            rez_value = media->getAudioStreamNb();
+        }
+    }
+    catch (...)
+    {
+        rez_value = -1;
+    }
+    return rez_value;
+}
+
 const short
 FFmpegWrapper::seekAudio(const long indexFile, const unsigned long time)
 {
@@ -429,6 +610,95 @@ FFmpegWrapper::getAudioInfo(const long indexFile, unsigned long * data)
     return rez_value;
 }
 
+const short
+FFmpegWrapper::preloadAudio(const long indexFile,
+                            unsigned short channelsNb,
+                            const AVSampleFormat & output_sampleFormat,
+                            unsigned short sample_rate,
+                            const size_t maxBytes)
+{
+    short rez_value = -1;
+    try
+    {
+        if (checkIndexAudioValid(indexFile) == 0)
+        {
+            FFMPEGAUDIOREADER* media = g_openedAudioFiles[indexFile];
+
+            if (media->preload(channelsNb, output_sampleFormat, sample_rate, maxBytes) >= 0)
+                rez_value = 0;
+        }
+    }
+    catch (...)
+    {
+        rez_value = -1;
+    }
+    return rez_value;
+}
+
+const short
+FFmpegWrapper::prefetchAudio(const long indexFile, const size_t maxBytes, const double maxDurationMS)
+{
+    short rez_value = -1;
+    try
+    {
+        if (checkIndexAudioValid(indexFile) == 0 && maxBytes > 0 && maxDurationMS > 0.0)
+        {
+            FFMPEGAUDIOREADER* media = g_openedAudioFiles[indexFile];
+
+            if (media->prefetch(maxBytes, maxDurationMS) >= 0)
+                rez_value = 0;
+        }
+    }
+    catch (...)
+    {
+        rez_value = -1;
+    }
+    return rez_value;
+}
+
+const short
+FFmpegWrapper::getAudioPrefetchStats(const long indexFile, FFmpegPacketPrefetcher::Stats & stats)
+{
+    short rez_value = -1;
+    try
+    {
+        if (checkIndexAudioValid(indexFile) == 0)
+        {
+            FFMPEGAUDIOREADER* media = g_openedAudioFiles[indexFile];
+
+            if (media->getPrefetchStats(stats) >= 0)
+                rez_value = 0;
+        }
+    }
+    catch (...)
+    {
+        rez_value = -1;
+    }
+    return rez_value;
+}
+
+const short
+FFmpegWrapper::setAudioDriftCompensation(const long indexFile, const double & compensation)
+{
+    short rez_value = -1;
+    try
+    {
+        if (checkIndexAudioValid(indexFile) == 0)
+        {
+            FFMPEGAUDIOREADER* media = g_openedAudioFiles[indexFile];
+
+            media->setCompensation(compensation);
+
+            rez_value = 0;
+        }
+    }
+    catch (...)
+    {
+        rez_value = -1;
+    }
+    return rez_value;
+}
+
 const int
 FFmpegWrapper::getAudioSamples(const long indexFile,
                                 unsigned long msTime,
@@ -19,6 +19,7 @@
 
 #include <map>
 #include "FFmpegHeaders.hpp"
+#include "FFmpegPacketPrefetcher.hpp"
 
 namespace osgFFmpeg {
 
@@ -142,6 +143,73 @@ public:
     //  Has not depending, if [minReqTimeMS] < 0.
     static const short getNextImage(const long indexFile, unsigned char * bufRGB24, double & timeStampInSec, const size_t & drop_frame_nb, const bool decodeTillMinReqTime = true, const double minReqTimeMS = -1.0);
 
+    // Get nearest frame(24-bit) which is before [beforeTimeMS]. Used for reverse playback.
+    //
+    // return values
+    // 0: No errors
+    // other: error or start of the video reached
+    //
+    // Notes:
+    // - No one exception throws from function;
+    // - Size of [bufRGB24] should be at less = (3 * width * height) in bytes;
+    // - [timeStampInSec] - output value is time-position of returned frame in seconds;
+    static const short getPrevImage(const long indexFile, unsigned char * bufRGB24, double & timeStampInSec, const double beforeTimeMS);
+
+    // Decode key-frames only (if [keyFramesOnly] is true) or all frames. Used for fast playback.
+    //
+    // return values
+    // 0: No errors
+    // other: error
+    //
+    // Notes:
+    // - No one exception throws from function;
+    static const short setVideoKeyFramesOnly(const long indexFile, const bool keyFramesOnly);
+
+    // Read all compressed packets of the video-stream into memory, if they take no more than [maxBytes].
+    // Used for short looped clips: the file is not read anymore, but frames are still decoded.
+    //
+    // return values
+    // 0: No errors
+    // other: error or video is too large
+    //
+    // Notes:
+    // - No one exception throws from function;
+    static const short preloadVideo(const long indexFile, const size_t maxBytes);
+
+    // Read compressed packets of the video-stream ahead by own I/O thread. Queue keeps no more than [maxBytes]
+    // and no more than [maxDurationMS] of the video. Used for network sources, so I/O stalls do not reach decoder.
+    //
+    // return values
+    // 0: No errors
+    // other: error or video is preloaded
+    //
+    // Notes:
+    // - No one exception throws from function;
+    static const short prefetchVideo(const long indexFile, const size_t maxBytes, const double maxDurationMS);
+
+    // Current state of the queue of the packets, read ahead by prefetchVideo()
+    //
+    // return values
+    // 0: No errors
+    // other: error or video is not prefetched
+    //
+    // Notes:
+    // - No one exception throws from function;
+    static const short getVideoPrefetchStats(const long indexFile, FFmpegPacketPrefetcher::Stats & stats);
+
+    // Get image(24-bit) of the next([direction] > 0) or previous([direction] < 0) frame relatively to frame at [fromTimeMS].
+    // Decoded frames of current GOP are cached, so repeated steps do not seek the file.
+    //
+    // return values
+    // 0: No errors
+    // other: error or start/end of the video reached
+    //
+    // Notes:
+    // - No one exception throws from function;
+    // - Size of [bufRGB24] should be at less = (3 * width * height) in bytes;
+    // - [timeStampInSec] - output value is time-position of returned frame in seconds;
+    static const short stepImage(const long indexFile, const int direction, const double fromTimeMS, unsigned char * bufRGB24, double & timeStampInSec);
+
     /// =======================================================================================================================================
     /// Access to read audio
     /// =======================================================================================================================================
@@ -158,6 +226,26 @@ public:
     // - Automatic initialization of stream-grabber(getAudioSamples) after successful seeking by ZERO.
     static const long  openAudio(const char * pFileName, FFmpegParameters * parameters);
 
+    // Open one more audio stream(track) of the audio-file(opened by [openAudio]).
+    // [audioStreamNb] is the number of audio stream in the file, starting from ZERO.
+    //
+    // return values
+    // -1: error;
+    // (0..N): Index of opened audio-track, which could be used as index of audio-file;
+    //
+    // Notes:
+    // - No one exception throws from function;
+    // - Packets of the file and of its tracks are demuxed in one pass, so seekAudio() of [indexFile]
+    //   seeks all of them. seekAudio() of the track only resets its decoder;
+    // - Track should be closed before [indexFile];
+    static const long  openAudioTrack(const long indexFile, const int audioStreamNb);
+
+    // Return number of audio streams in the audio-file or negative value if error
+    //
+    // Notes:
+    // - No one exception throws from function;
+    static const int   getAudioStreamNb(const long indexFile);
+
     // Notes:
     // - No one exception throws from function;
     // - Automatic initialization of stream-grabber(getAudioSamples) after successful seeking.
@@ -200,6 +288,60 @@ public:
     // - No one exception throws from function;
     static const short closeAudio(const long indexFile);
 
+    // Correct drift between clock of the audio device and system clock.
+    // [compensation] is relative number of samples, which should be added(if positive) or removed(if negative)
+    // by resampler. For example: 0.001 adds 1 sample per each 1000 grabbed samples.
+    //
+    // return values
+    // 0: No errors
+    // other: error
+    //
+    // Notes:
+    // - No one exception throws from function;
+    // - Takes effect only if audio is resampled by swresample;
+    static const short setAudioDriftCompensation(const long indexFile, const double & compensation);
+
+    // Decode whole audio into memory with output format, if it takes no more than [maxBytes].
+    // After that getAudioSamples() copies samples from memory, and seekAudio() does not touch the file.
+    //
+    // return values
+    // 0: No errors
+    // other: error or audio is too long
+    //
+    // Notes:
+    // - No one exception throws from function;
+    // - getAudioSamples() should be called with the same format;
+    // - Audio-file with opened tracks(see openAudioTrack()) could not be preloaded;
+    // - Drift compensation(see setAudioDriftCompensation()) has no effect for preloaded audio;
+    static const short preloadAudio(const long indexFile,
+                                        unsigned short channelsNb,
+                                        const AVSampleFormat & output_sampleFormat,
+                                        unsigned short sample_rate,
+                                        const size_t maxBytes);
+
+    // Read compressed packets of the audio-file ahead by own I/O thread, as prefetchVideo() does.
+    //
+    // return values
+    // 0: No errors
+    // other: error or audio is preloaded
+    //
+    // Notes:
+    // - No one exception throws from function;
+    // - Packets of opened tracks(see openAudioTrack()) are read ahead too, so tracks should be opened before;
+    // - Index of the track is not accepted, track is read ahead by its audio-file;
+    static const short prefetchAudio(const long indexFile, const size_t maxBytes, const double maxDurationMS);
+
+    // Current state of the queue of the packets, read ahead by prefetchAudio()
+    //
+    // return values
+    // 0: No errors
+    // other: error or audio is not prefetched
+    //
+    // Notes:
+    // - No one exception throws from function;
+    // - Track reports the queue of its audio-file;
+    static const short getAudioPrefetchStats(const long indexFile, FFmpegPacketPrefetcher::Stats & stats);
+
     // Streaming-grabbing of required number of audio-samples from the opened audio-file.
     // Each calling this function will start of grabbing from the previous end-point.
     // If you need start of grabbing from the custom point, you should use seekAudio().
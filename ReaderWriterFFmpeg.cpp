@@ -17,12 +17,21 @@
 
 #include "FFmpegHeaders.hpp"
 #include "FFmpegPlayer.hpp"
+#include "FFmpegPlaylistPlayer.hpp"
+#include "FFmpegImageView.hpp"
 #include "FFmpegParameters.hpp"
+#include "FFmpegMemorySource.hpp"
+#include "FFmpegThumbnailer.hpp"
+#include "VideoMemoryManager.hpp"
 
+#include <osg/ImageSequence>
 #include <osgDB/Registry>
 #include <osgDB/FileNameUtils>
 #include <osgDB/FileUtils>
 
+#include <sstream>
+#include <fstream>
+
 
 
 extern "C" {
@@ -108,6 +117,7 @@ public:
         supportsExtension("wav",   "");
         supportsExtension("aiff",   "");
         supportsExtension("mp2",   "");
+        supportsExtension("m3u",    "Playlist of media files, which are played one by one");
 
         supportsOption("format",            "Force setting input format (e.g. vfwcap for Windows webcam)");
         supportsOption("pixel_format",      "Set pixel format");
@@ -115,7 +125,25 @@ public:
         supportsOption("video_size",        "Set frame size (e.g. 320x240)"); // no such parameter as "frame_size"
         supportsOption("frame_rate",        "Set frame rate (e.g. 25:1)");
         supportsOption("audio_sample_rate", "Set audio sampling rate (e.g. 44100)");
+        supportsOption("audio_sample_format", "Set audio sample format: u8, s16 (default), s32, flt or auto (format of decoder)");
+        supportsOption("audio_stream",      "Play audio stream with this number (e.g. 1 for second audio stream)");
+        supportsOption("audio_language",    "Play audio stream with this language tag (e.g. eng)");
+        supportsOption("audio_tracks",      "Decode extra audio streams: all, or comma separated numbers (e.g. 1,2)");
+        supportsOption("audio_only",        "Open without video: yes or no (default is yes for wav, aiff and mp2 files)");
+        supportsOption("preload_duration",  "Keep clips not longer than this duration in memory, in ms (e.g. 10000)");
+        supportsOption("preload_size",      "Memory for one preloaded clip in MB (default is 32)");
+        supportsOption("prefetch_duration", "Read ahead this duration of packets in ms, 0 disables (default is 5000 for network sources)");
+        supportsOption("prefetch_size",     "Memory for packets read ahead in MB (default is 16)");
         supportsOption("context",            "AVIOContext* for custom IO");
+        supportsOption("memory_source",     "FFmpegMemorySource* to read media from memory instead of the file");
+        supportsOption("mmap",              "Read local file from memory mapping, shared by players of the same file: yes or no (default is no)");
+        supportsOption("shared_cache",      "Read file through cache of this size in MB, shared by players of the same file (e.g. 64)");
+        supportsOption("shared_decode",     "Decode file once for all its images, which play in lock-step: yes or no (default is no)");
+        supportsOption("reference_clock",   "Select frames by time of the application: simulation (time of frame stamp) or empty (own clock)");
+        supportsOption("offline",           "Render every frame of the reference time without real-time pacing and audio: yes or no (default is no)");
+        supportsOption("thumbnail_times",   "Read thumbnails instead of video at comma separated times in ms (e.g. 0,5000,10000)");
+        supportsOption("thumbnail_size",    "Max size of thumbnail (e.g. 160x120)");
+        supportsOption("video_memory_budget", "Memory for decoded frames of all videos in MB (default is 1/4 of physical RAM)");
 
 #ifdef USE_AV_LOCK_MANAGER
         // enable thread locking
@@ -160,6 +188,13 @@ public:
         osg::ref_ptr<osgFFmpeg::FFmpegParameters> parameters(new osgFFmpeg::FFmpegParameters);
         parseOptions(parameters.get(), options);
 
+        if (options && options->getPluginStringData("video_memory_budget").empty() == false)
+        {
+            const double budgetMB = atof(options->getPluginStringData("video_memory_budget").c_str());
+
+            osgFFmpeg::VideoMemoryManager::instance().setBudget((size_t)(budgetMB * 1024.0 * 1024.0));
+        }
+
         if (filename.compare(0, 5, "/dev/")==0)
         {
             return readImageStream(filename, parameters.get());
@@ -182,9 +217,139 @@ public:
         if (path.empty())
             return ReadResult::FILE_NOT_FOUND;
 
+        if (ext == "m3u")
+            return readPlaylist(path, parameters.get(), options);
+
+        if (options && options->getPluginStringData("thumbnail_times").empty() == false)
+        {
+            return readThumbnails(path,
+                                options->getPluginStringData("thumbnail_times"),
+                                options->getPluginStringData("thumbnail_size"));
+        }
+
+        if (options)
+        {
+            const std::string sharedDecode = options->getPluginStringData("shared_decode");
+
+            if (sharedDecode == "1" || sharedDecode == "yes" || sharedDecode == "true")
+                return readImageView(path, parameters.get());
+        }
+
         return readImageStream(path, parameters.get());
     }
 
+    // Media from the stream (e.g. entry of archive) is copied to memory, because demuxer requires seeking
+    virtual ReadResult readImage(std::istream & fin, const osgDB::ReaderWriter::Options* options) const
+    {
+        std::vector<unsigned char>  bytes;
+        char                        buffer[64 * 1024];
+
+        while (fin.read(buffer, sizeof(buffer)) || fin.gcount() > 0)
+        {
+            bytes.insert(bytes.end(), buffer, buffer + fin.gcount());
+        }
+        if (bytes.empty())
+            return ReadResult::ERROR_IN_READING_FILE;
+
+        osg::ref_ptr<osgFFmpeg::FFmpegParameters> parameters(new osgFFmpeg::FFmpegParameters);
+        parseOptions(parameters.get(), options);
+        parameters->setMemorySource(new osgFFmpeg::FFmpegMemorySource(bytes));
+
+        return readImageStream("memory", parameters.get());
+    }
+
+    ReadResult readThumbnails(const std::string& filename, const std::string& times, const std::string& size) const
+    {
+        av_log(NULL, AV_LOG_INFO, "ReaderWriterFFmpeg::readThumbnails %s", filename.c_str());
+
+        int                 width   = 160;
+        int                 height  = 120;
+
+        if (size.empty() == false && av_parse_video_size(& width, & height, size.c_str()) < 0)
+        {
+            av_log(NULL, AV_LOG_WARNING, "Wrong thumbnail size %s", size.c_str());
+            return ReadResult::ERROR_IN_READING_FILE;
+        }
+
+        osgFFmpeg::FFmpegThumbnailJob   job;
+        std::istringstream              timesStream(times);
+        std::string                     timeValue;
+
+        job.FileName = filename;
+        while (std::getline(timesStream, timeValue, ','))
+        {
+            if (timeValue.empty() == false)
+                job.TimesMS.push_back(atof(timeValue.c_str()));
+        }
+
+        if (osgFFmpeg::FFmpegThumbnailer::grabJob(job, width, height) <= 0)
+            return ReadResult::FILE_NOT_HANDLED;
+
+        if (job.Images.size() == 1)
+            return job.Images[0].valid() ? ReadResult(job.Images[0].release()) : ReadResult(ReadResult::ERROR_IN_READING_FILE);
+        //
+        // Many thumbnails are returned as sequence of images in order of required times.
+        // Failed thumbnail is kept as empty image, so index of image matches index of its time.
+        //
+        osg::ref_ptr<osg::ImageSequence>    sequence = new osg::ImageSequence;
+
+        for (size_t i = 0; i < job.Images.size(); ++i)
+        {
+            if (job.Images[i].valid())
+                sequence->addImage(job.Images[i].get());
+            else
+                sequence->addImage(new osg::Image);
+        }
+        return sequence.release();
+    }
+
+    ReadResult readPlaylist(const std::string& filename, osgFFmpeg::FFmpegParameters* parameters, const osgDB::ReaderWriter::Options* options) const
+    {
+        av_log(NULL, AV_LOG_INFO, "ReaderWriterFFmpeg::readPlaylist %s", filename.c_str());
+
+        std::ifstream               stream(filename.c_str());
+        if (! stream)
+            return ReadResult::ERROR_IN_READING_FILE;
+
+        const std::string           playlistPath = osgDB::getFilePath(filename);
+        std::vector<std::string>    items;
+        std::string                 line;
+
+        while (std::getline(stream, line))
+        {
+            const size_t    first = line.find_first_not_of(" \t\r");
+            const size_t    last = line.find_last_not_of(" \t\r");
+
+            // Empty lines and comments (including extended M3U tags) are skipped
+            if (first == std::string::npos || line[first] == '#')
+                continue;
+
+            std::string     item = line.substr(first, last - first + 1);
+            //
+            // Relative path is searched near the playlist first
+            //
+            if (osgDB::containsServerAddress(item) == false && osgDB::isAbsolutePath(item) == false)
+            {
+                const std::string   localItem = osgDB::concatPaths(playlistPath, item);
+
+                item = osgDB::fileExists(localItem) ? localItem : osgDB::findDataFile(item, options);
+            }
+            if (item.empty())
+            {
+                av_log(NULL, AV_LOG_WARNING, "Playlist item %s is not found", line.c_str());
+                continue;
+            }
+            items.push_back(item);
+        }
+
+        osg::ref_ptr<osgFFmpeg::FFmpegPlaylistPlayer> image_stream(new osgFFmpeg::FFmpegPlaylistPlayer);
+
+        if (! image_stream->open(items, parameters))
+            return ReadResult::FILE_NOT_HANDLED;
+
+        return image_stream.release();
+    }
+
     ReadResult readImageStream(const std::string& filename, osgFFmpeg::FFmpegParameters* parameters) const
     {
         av_log(NULL, AV_LOG_INFO, "ReaderWriterFFmpeg::readImage %s", filename.c_str());
@@ -198,6 +363,18 @@ public:
         return image_stream.release();
     }
 
+    ReadResult readImageView(const std::string& filename, osgFFmpeg::FFmpegParameters* parameters) const
+    {
+        av_log(NULL, AV_LOG_INFO, "ReaderWriterFFmpeg::readImageView %s", filename.c_str());
+
+        osg::ref_ptr<osgFFmpeg::FFmpegImageView> image_view(new osgFFmpeg::FFmpegImageView);
+
+        if (! image_view->open(filename, parameters))
+            return ReadResult::FILE_NOT_HANDLED;
+
+        return image_view.release();
+    }
+
 private:
 
     void parseOptions(osgFFmpeg::FFmpegParameters* parameters, const osgDB::ReaderWriter::Options * options) const
@@ -219,6 +396,11 @@ private:
             {
                 parameters->setContext(context);
             }
+            osgFFmpeg::FFmpegMemorySource* memorySource = (osgFFmpeg::FFmpegMemorySource*)options->getPluginData("memory_source");
+            if (memorySource != NULL)
+            {
+                parameters->setMemorySource(memorySource);
+            }
         }
     }
 
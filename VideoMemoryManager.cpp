@@ -0,0 +1,249 @@
+/* Improved ffmpeg plugin for OpenSceneGraph -
+ * Copyright (C) 2014-2015 Digitalis Education Solutions, Inc. (http://DigitalisEducation.com)
+ * File author: Oktay Radzhabov (oradzhabov at jazzros dot com)
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+#include "VideoMemoryManager.hpp"
+#include <osg/Notify>
+#include <algorithm>
+
+size_t getMemorySize();
+
+namespace osgFFmpeg
+{
+
+const size_t VideoMemoryManager::MinFrameNb;
+const size_t VideoMemoryManager::MaxFrameNb;
+
+VideoMemoryManager::VideoMemoryManager()
+:m_budget(getMemorySize() / 4) // could be 0, which means unlimited
+{
+}
+
+VideoMemoryManager &
+VideoMemoryManager::instance()
+{
+    static VideoMemoryManager   s_instance;
+
+    return s_instance;
+}
+
+void
+VideoMemoryManager::setBudget(const size_t & bytes)
+{
+    ScopedLock                          notifyLock (m_notifyMutex);
+    std::vector<VideoMemoryListener *>  changed;
+    {
+        ScopedLock  lock (m_mutex);
+
+        m_budget = bytes;
+        redistribute(changed);
+    }
+    notify(changed);
+}
+
+const size_t
+VideoMemoryManager::getBudget() const
+{
+    ScopedLock  lock (m_mutex);
+
+    return m_budget;
+}
+
+const bool
+VideoMemoryManager::registerClient(const void * client, const size_t & frameSize, VideoMemoryListener * listener)
+{
+    ScopedLock                          notifyLock (m_notifyMutex);
+    std::vector<VideoMemoryListener *>  changed;
+    {
+        ScopedLock  lock (m_mutex);
+        //
+        // Minimal frames of registered clients are not taken back, so new client is refused
+        //
+        if (m_budget > 0)
+        {
+            size_t  minBytes = MinFrameNb * frameSize;
+
+            for (ClientMap::const_iterator it = m_clients.begin(); it != m_clients.end(); ++it)
+            {
+                if (it->first != client)
+                    minBytes += MinFrameNb * it->second.FrameSize;
+            }
+            if (minBytes > m_budget)
+                return false;
+        }
+
+        Client &    c = m_clients[client];
+
+        c.FrameSize = frameSize;
+        c.Quota = 0;
+        c.Playing = false;
+        c.Visible = true;
+        c.Listener = listener;
+
+        redistribute(changed);
+        // New client reads its quota itself
+        changed.erase(std::remove(changed.begin(), changed.end(), listener), changed.end());
+    }
+    notify(changed);
+
+    return true;
+}
+
+void
+VideoMemoryManager::unregisterClient(const void * client)
+{
+    ScopedLock                          notifyLock (m_notifyMutex);
+    std::vector<VideoMemoryListener *>  changed;
+    {
+        ScopedLock  lock (m_mutex);
+
+        if (m_clients.erase(client) == 0)
+            return;
+
+        redistribute(changed);
+    }
+    notify(changed);
+}
+
+void
+VideoMemoryManager::setPlaying(const void * client, const bool value)
+{
+    ScopedLock                          notifyLock (m_notifyMutex);
+    std::vector<VideoMemoryListener *>  changed;
+    {
+        ScopedLock  lock (m_mutex);
+
+        ClientMap::iterator it = m_clients.find(client);
+        if (it == m_clients.end() || it->second.Playing == value)
+            return;
+
+        it->second.Playing = value;
+        redistribute(changed);
+    }
+    notify(changed);
+}
+
+void
+VideoMemoryManager::setVisible(const void * client, const bool value)
+{
+    ScopedLock                          notifyLock (m_notifyMutex);
+    std::vector<VideoMemoryListener *>  changed;
+    {
+        ScopedLock  lock (m_mutex);
+
+        ClientMap::iterator it = m_clients.find(client);
+        if (it == m_clients.end() || it->second.Visible == value)
+            return;
+
+        it->second.Visible = value;
+        redistribute(changed);
+    }
+    notify(changed);
+}
+
+const size_t
+VideoMemoryManager::frameQuota(const void * client) const
+{
+    ScopedLock  lock (m_mutex);
+
+    ClientMap::const_iterator   it = m_clients.find(client);
+
+    return (it != m_clients.end()) ? it->second.Quota : 0;
+}
+
+void
+VideoMemoryManager::redistribute(std::vector<VideoMemoryListener *> & changed)
+{
+    std::map<const void *, size_t>  quotas;
+    double                          freeBytes = (double)m_budget;
+    ClientMap::iterator             it;
+    //
+    // Minimal frames are reserved first, the rest of the budget is shared by weights
+    //
+    for (it = m_clients.begin(); it != m_clients.end(); ++it)
+    {
+        if (it->second.FrameSize == 0)
+            quotas[it->first] = 0;
+        else if (m_budget == 0)
+            quotas[it->first] = MaxFrameNb;
+        else
+            freeBytes -= (double)(MinFrameNb * it->second.FrameSize);
+    }
+    if (freeBytes < 0.0)
+    {
+        OSG_WARN << "Video memory budget is less than minimal frames of opened videos" << std::endl;
+        freeBytes = 0.0;
+    }
+    //
+    // Share of the client, which exceeds max frame number, is given to others
+    //
+    while (quotas.size() < m_clients.size())
+    {
+        unsigned int    weightSum   = 0;
+        bool            isCapped    = false;
+
+        for (it = m_clients.begin(); it != m_clients.end(); ++it)
+        {
+            if (quotas.find(it->first) == quotas.end())
+                weightSum += it->second.Weight();
+        }
+        const double    sharedBytes = freeBytes;
+
+        for (it = m_clients.begin(); it != m_clients.end(); ++it)
+        {
+            if (quotas.find(it->first) != quotas.end())
+                continue;
+
+            const size_t    frameNb = MinFrameNb + (size_t)(sharedBytes * it->second.Weight() / weightSum / (double)it->second.FrameSize);
+            if (frameNb >= MaxFrameNb)
+            {
+                quotas[it->first] = MaxFrameNb;
+                freeBytes -= (double)((MaxFrameNb - MinFrameNb) * it->second.FrameSize);
+                isCapped = true;
+            }
+        }
+        if (isCapped)
+            continue;
+
+        for (it = m_clients.begin(); it != m_clients.end(); ++it)
+        {
+            if (quotas.find(it->first) == quotas.end())
+                quotas[it->first] = MinFrameNb + (size_t)(sharedBytes * it->second.Weight() / weightSum / (double)it->second.FrameSize);
+        }
+    }
+
+    for (it = m_clients.begin(); it != m_clients.end(); ++it)
+    {
+        const size_t    quota = quotas[it->first];
+
+        if (it->second.Quota != quota)
+        {
+            it->second.Quota = quota;
+            if (it->second.Listener != NULL)
+                changed.push_back(it->second.Listener);
+        }
+    }
+}
+
+void
+VideoMemoryManager::notify(const std::vector<VideoMemoryListener *> & changed)
+{
+    for (size_t i = 0; i < changed.size(); ++i)
+    {
+        changed[i]->onFrameQuotaChanged();
+    }
+}
+
+} // namespace osgFFmpeg
@@ -0,0 +1,100 @@
+/* Improved ffmpeg plugin for OpenSceneGraph -
+ * Copyright (C) 2014-2015 Digitalis Education Solutions, Inc. (http://DigitalisEducation.com)
+ * File author: Oktay Radzhabov (oradzhabov at jazzros dot com)
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+#ifndef HEADER_GUARD_FFMPEG_VIDEOMEMORYMANAGER_H
+#define HEADER_GUARD_FFMPEG_VIDEOMEMORYMANAGER_H
+
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
+#include <map>
+#include <vector>
+#include <cstddef>
+
+namespace osgFFmpeg {
+
+//
+// Owner of the registered buffer, which applies changed quota
+//
+class VideoMemoryListener
+{
+public:
+    virtual                         ~VideoMemoryListener() {}
+    // Quota of the client has been changed by state of other clients or by the budget.
+    // Called from the thread, which has changed the state, out of the lock of the manager.
+    virtual void                    onFrameQuotaChanged() = 0;
+};
+
+//
+// Process-wide budget of memory used by decoded frames of all video buffers.
+// Budget is shared between registered buffers by weights: playing buffers get
+// the most frames, visible paused buffers less, and hidden paused buffers the least.
+// Quotas of all clients are recomputed together, so their sum never exceeds the budget.
+// Every client is guaranteed MinFrameNb frames: new client is refused, if the budget could not cover it.
+//
+class VideoMemoryManager
+{
+    typedef OpenThreads::Mutex              Mutex;
+    typedef OpenThreads::ScopedLock<Mutex>  ScopedLock;
+
+    struct Client
+    {
+        size_t                  FrameSize;
+        size_t                  Quota;
+        bool                    Playing;
+        bool                    Visible;
+        VideoMemoryListener *   Listener;
+        //
+        const unsigned int  Weight() const
+        {
+            return Playing ? 4 : (Visible ? 2 : 1);
+        }
+    };
+    typedef std::map<const void *, Client>  ClientMap;
+
+    mutable Mutex                   m_mutex;
+    Mutex                           m_notifyMutex;  // Listeners are notified one change at a time, and not after unregistration
+    ClientMap                       m_clients;
+    size_t                          m_budget;   // in bytes. ZERO means unlimited
+
+    // Recompute quotas of all clients. Listeners of changed quotas are added to [changed]. Should be called under \m_mutex
+    void                            redistribute(std::vector<VideoMemoryListener *> & changed);
+    void                            notify(const std::vector<VideoMemoryListener *> & changed);
+
+                                    VideoMemoryManager();
+                                    VideoMemoryManager(const VideoMemoryManager &){}; // hide copy constructor
+public:
+    // Frame number limits of one buffer, independently of the budget
+    static const size_t             MinFrameNb = 4;
+    static const size_t             MaxFrameNb = 20;
+
+    static VideoMemoryManager &     instance();
+
+    void                            setBudget(const size_t & bytes);
+    const size_t                    getBudget() const;
+
+    // Returns false if the budget could not cover minimal frame number of all clients with new one
+    const bool                      registerClient(const void * client, const size_t & frameSize, VideoMemoryListener * listener = NULL);
+    void                            unregisterClient(const void * client);
+    void                            setPlaying(const void * client, const bool value);
+    void                            setVisible(const void * client, const bool value);
+
+    // Number of frames, which [client] may keep in memory now
+    const size_t                    frameQuota(const void * client) const;
+};
+
+} // namespace osgFFmpeg
+
+#endif // HEADER_GUARD_FFMPEG_VIDEOMEMORYMANAGER_H
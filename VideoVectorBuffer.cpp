@@ -16,15 +16,229 @@
 
 #include "VideoVectorBuffer.hpp"
 #include "FFmpegWrapper.hpp"
+#include "VideoMemoryManager.hpp"
 #include <limits>
+#include <algorithm>
 
-size_t getMemorySize();
+#if defined(__linux__)
+    #include <sys/mman.h>
+    #include <unistd.h>
+    #define OSG_USE_MMAP_SLAB
+#endif
 
 namespace osgFFmpeg
 {
 
+namespace {
+
+const size_t                    SlabAlignment       = 64;
+// Without lazy commit recycled slabs keep their memory, so the pool is limited by size
+const size_t                    RecycledSlabsMaxBytes = 64 * 1024 * 1024;
+
+struct RecycledSlab
+{
+    unsigned char *             Ptr;
+    size_t                      Size;
+};
+
+OpenThreads::Mutex              g_recycledSlabsMutex;
+std::vector<RecycledSlab>       g_recycledSlabs;
+size_t                          g_recycledSlabsBytes = 0;
+
+unsigned char *
+allocSlab(const size_t & size)
+{
+#ifdef OSG_USE_MMAP_SLAB
+    void *          ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (ptr == MAP_FAILED)
+        return NULL;
+#ifdef MADV_HUGEPAGE
+    // Big frames are processed sequentially, so huge pages reduce TLB misses
+    madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+    return (unsigned char *)ptr;
+#else
+    //
+    // Alignment of av_malloc() depends on configuration of ffmpeg, so region is aligned here.
+    // Original pointer is stored just before aligned region.
+    //
+    unsigned char * base = (unsigned char *)av_malloc(size + SlabAlignment + sizeof(void *));
+
+    if (base == NULL)
+        return NULL;
+
+    unsigned char * aligned = (unsigned char *)(((uintptr_t)(base + sizeof(void *)) + SlabAlignment - 1) & ~(uintptr_t)(SlabAlignment - 1));
+    ((void **)aligned)[-1] = base;
+
+    return aligned;
+#endif
+}
+
+void
+freeSlab(unsigned char * ptr, const size_t & size)
+{
+#ifdef OSG_USE_MMAP_SLAB
+    munmap(ptr, size);
+#else
+    av_free(((void **)ptr)[-1]);
+#endif
+}
+
+// Give physical pages of unused memory back to OS, but keep the address range
+void
+discardPages(unsigned char * ptr, const size_t & size)
+{
+#ifdef OSG_USE_MMAP_SLAB
+    const uintptr_t pageSize    = sysconf(_SC_PAGESIZE);
+    const uintptr_t start       = ((uintptr_t)ptr + pageSize - 1) & ~(pageSize - 1);
+    const uintptr_t end         = ((uintptr_t)ptr + size) & ~(pageSize - 1);
+
+    if (end > start)
+        madvise((void *)start, end - start, MADV_DONTNEED);
+#endif
+}
+
+unsigned char *
+acquireSlab(const size_t & size)
+{
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(g_recycledSlabsMutex);
+
+        for (size_t i = 0; i < g_recycledSlabs.size(); ++i)
+        {
+            if (g_recycledSlabs[i].Size == size)
+            {
+                unsigned char * ptr = g_recycledSlabs[i].Ptr;
+                g_recycledSlabsBytes -= size;
+                g_recycledSlabs.erase(g_recycledSlabs.begin() + i);
+                return ptr;
+            }
+        }
+    }
+    return allocSlab(size);
+}
+
+void
+recycleSlab(unsigned char * ptr, const size_t & size)
+{
+    if (size > RecycledSlabsMaxBytes)
+    {
+        freeSlab(ptr, size);
+        return;
+    }
+    discardPages(ptr, size);
+
+    std::vector<RecycledSlab>   evicted;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(g_recycledSlabsMutex);
+        //
+        // Oldest slabs are freed to keep the pool in its limit
+        //
+        while (g_recycledSlabsBytes + size > RecycledSlabsMaxBytes)
+        {
+            evicted.push_back(g_recycledSlabs.front());
+            g_recycledSlabsBytes -= g_recycledSlabs.front().Size;
+            g_recycledSlabs.erase(g_recycledSlabs.begin());
+        }
+        RecycledSlab    slab;
+        slab.Ptr = ptr;
+        slab.Size = size;
+        g_recycledSlabs.push_back(slab);
+        g_recycledSlabsBytes += size;
+    }
+    for (size_t i = 0; i < evicted.size(); ++i)
+    {
+        freeSlab(evicted[i].Ptr, evicted[i].Size);
+    }
+}
+
+} // namespace
+
+void
+VideoVectorBuffer::MemoryPool::release()
+{
+    if (m_slab != NULL)
+    {
+        recycleSlab(m_slab, m_slabSize);
+    }
+    m_slab = NULL;
+    m_slabSize = 0;
+    m_stride = 0;
+    m_ptr.clear();
+    m_free.clear();
+}
+
+void
+VideoVectorBuffer::MemoryPool::alloc(const size_t & frameSize, const size_t & frame_nb, const size_t & capacity)
+{
+    release();
+
+    m_stride = (frameSize + SlabAlignment - 1) & ~(SlabAlignment - 1);
+    m_slabSize = m_stride * std::max(capacity, frame_nb);
+    m_slab = acquireSlab(m_slabSize);
+
+    if (m_slab == NULL)
+    {
+        m_slabSize = 0;
+        return;
+    }
+    // First activated frames have lowest addresses
+    for (size_t i = m_slabSize / m_stride; i > 0; --i)
+    {
+        m_free.push_back(m_slab + (i - 1) * m_stride);
+    }
+    resize(frame_nb);
+}
+
+void
+VideoVectorBuffer::MemoryPool::swap(MemoryPool & other)
+{
+    m_ptr.swap(other.m_ptr);
+    m_free.swap(other.m_free);
+    std::swap(m_slab, other.m_slab);
+    std::swap(m_slabSize, other.m_slabSize);
+    std::swap(m_stride, other.m_stride);
+}
+
+void
+VideoVectorBuffer::MemoryPool::resize(const size_t & frame_nb)
+{
+    while (m_ptr.size() > frame_nb)
+    {
+        discardPages(m_ptr.back(), m_stride);
+        m_free.push_back(m_ptr.back());
+        m_ptr.pop_back();
+    }
+    while (m_ptr.size() < frame_nb && m_free.empty() == false)
+    {
+        unsigned char * ptr = m_free.back();
+
+        memset (ptr, 0, m_stride); // Clear frame to avoid prev memory state
+        m_ptr.push_back(ptr);
+        m_free.pop_back();
+    }
+}
+
+const size_t
+VideoVectorBuffer::slabCapacity(const size_t & quota)
+{
+#ifdef OSG_USE_MMAP_SLAB
+    // Pages are committed when frames are used first time, so slab reserves max frame number
+    return VideoMemoryManager::MaxFrameNb;
+#else
+    // Memory of the whole slab is committed, so it keeps only frames of the quota
+    return quota;
+#endif
+}
+
 VideoVectorBuffer::VideoVectorBuffer()
-:m_fileIndex(-1)
+:m_fileIndex(-1),
+m_reverse(false),
+m_reverseTimeMS(0.0),
+m_lastFramePtr(NULL),
+m_loop(false),
+m_loopGeneration(0)
 {
 }
 
@@ -63,7 +277,7 @@ VideoVectorBuffer::flush()
 }
 
 const int
-VideoVectorBuffer::alloc(const FFmpegFileHolder * pHolder)
+VideoVectorBuffer::alloc(const FFmpegFileHolder * pHolder, VideoMemoryListener * listener)
 {
     if (pHolder == NULL)
         return -1;
@@ -85,15 +299,24 @@ VideoVectorBuffer::alloc(const FFmpegFileHolder * pHolder)
     //
     try
     {
-        {
-            ScopedLock  lock (m_mutex);
-
-            m_frameSize = avpicture_get_size(pHolder->getPixFormat(), pHolder->width(), pHolder->height());
+        //
+        // Frame number is limited by process-wide budget, shared by all video buffers.
+        // Manager notifies listeners, so it is not called under \m_mutex
+        //
+        const size_t    frameSize = avpicture_get_size(pHolder->getPixFormat(), pHolder->width(), pHolder->height());
 
-            const size_t    partOfPhysicMemorySizeInBytes = floor((double)getMemorySize() / 4.0); // could return 0
-            const size_t    available_frame_nb = partOfPhysicMemorySizeInBytes > 0 ? (std::min<size_t>(20, floor((double)partOfPhysicMemorySizeInBytes / (double)m_frameSize))) : 20;
+        if (VideoMemoryManager::instance().registerClient(this, frameSize, listener) == false)
+        {
+            av_log(NULL, AV_LOG_ERROR, "Video memory budget could not cover frames of the video");
+            return -1;
+        }
+        {
+            ScopedLock      lock (m_mutex);
+            const size_t    quota = VideoMemoryManager::instance().frameQuota(this);
 
-            m_pool.alloc(m_frameSize, available_frame_nb);
+            m_frameSize = frameSize;
+            m_pool.alloc(m_frameSize, quota, slabCapacity(quota));
+            m_lastFramePtr = NULL;
 
             av_log(NULL, AV_LOG_INFO, "Video allocs pool for %d frames\n", m_pool.FrameCount());
             //
@@ -104,8 +327,11 @@ VideoVectorBuffer::alloc(const FFmpegFileHolder * pHolder)
             m_fps = pHolder->frameRate();
         }
 
-        flush();
-        err = 0;
+        if (m_pool.FrameCount() > 0)
+        {
+            flush();
+            err = 0;
+        }
     }
     catch (...)
     {
@@ -116,12 +342,80 @@ VideoVectorBuffer::alloc(const FFmpegFileHolder * pHolder)
 void
 VideoVectorBuffer::release()
 {
+    // Manager notifies listeners of other buffers, so it is not called under \m_mutex
+    VideoMemoryManager::instance().unregisterClient(this);
+
     ScopedLock  lock (m_mutex);
 
     m_pool.release();
+    m_lastFramePtr = NULL;
     m_fileIndex = -1;
 }
 
+void
+VideoVectorBuffer::setPlaying(const bool value)
+{
+    VideoMemoryManager::instance().setPlaying(this, value);
+}
+
+void
+VideoVectorBuffer::setVisible(const bool value)
+{
+    VideoMemoryManager::instance().setVisible(this, value);
+}
+
+const bool
+VideoVectorBuffer::applyMemoryQuota()
+{
+    if (m_fileIndex < 0)
+        return false;
+
+    const size_t    quota = VideoMemoryManager::instance().frameQuota(this);
+    {
+        ScopedLock  lock (m_mutex);
+
+        if (quota == 0 || quota == m_pool.FrameCount())
+            return false;
+        //
+        // Last returned frame is still displayed by player's image, so it should not be freed.
+        // Keep it in the first frame, which is published after flush.
+        //
+        std::vector<unsigned char *>::iterator  displayed = std::find(m_pool.m_ptr.begin(), m_pool.m_ptr.end(), m_lastFramePtr);
+        if (displayed != m_pool.m_ptr.end())
+            std::iter_swap(m_pool.m_ptr.begin(), displayed);
+        else
+            m_lastFramePtr = NULL;
+        //
+        // Slab, which could not keep all frames of the quota, is reallocated. Displayed frame is moved into it
+        //
+        if (slabCapacity(quota) != m_pool.Capacity())
+        {
+            MemoryPool  pool;
+
+            pool.alloc(m_frameSize, quota, slabCapacity(quota));
+            if (pool.FrameCount() > 0)
+            {
+                if (m_lastFramePtr != NULL)
+                {
+                    memcpy(pool.m_ptr[0], m_lastFramePtr, m_frameSize);
+                    m_lastFramePtr = pool.m_ptr[0];
+                }
+                m_pool.swap(pool);
+            }
+            else
+            {
+                av_log(NULL, AV_LOG_WARNING, "Cannot reallocate video pool");
+            }
+        }
+        m_pool.resize(quota);
+
+        av_log(NULL, AV_LOG_INFO, "Video pool resized to %d frames\n", m_pool.FrameCount());
+    }
+    flush();
+
+    return true;
+}
+
 /*
 * If Return value is 0(No error, and ptr are active), user SHOULD call ReleaseFoundFrame()
 * to release memory. Before calling ReleaseFoundFrame(), user may use returned ptr with guaranty
@@ -139,10 +433,11 @@ VideoVectorBuffer::GetFramePtr(const unsigned long & msTime,
     if (m_fileIndex < 0)
         return -1;
 
-    if (msTime >= m_videoLength)
-        return -1;
-
     ScopedLock  lock (m_mutex);
+
+    // Looped playback time exceeds duration of the file. Generation is changed by grabbing thread
+    if (m_loop == false && msTime >= (double)m_videoLength * (m_loopGeneration + 1))
+        return -1;
 /*
     //
     // Display video buffer state
@@ -177,6 +472,7 @@ VideoVectorBuffer::GetFramePtr(const unsigned long & msTime,
     if (fillFrameCount == m_pool.FrameCount())
     {
         pArray = m_pool.m_ptr[m_bufferGrabPtrStart];
+        m_lastFramePtr = pArray;
         return 1;
     }
     bool                hasBufferedData = false;
@@ -200,7 +496,7 @@ VideoVectorBuffer::GetFramePtr(const unsigned long & msTime,
     {
         for (searchRezult = searchStart_1; searchRezult < searchEnd_1; ++searchRezult)
         {
-            if (m_timeMappingList[searchRezult].Time >= timeInSec)
+            if (isFrameActual(m_timeMappingList[searchRezult].Time, timeInSec))
             {
                 break;
             }
@@ -214,7 +510,7 @@ VideoVectorBuffer::GetFramePtr(const unsigned long & msTime,
     {
         for (searchRezult = searchStart_2; searchRezult < searchEnd_2; ++searchRezult)
         {
-            if (m_timeMappingList[searchRezult].Time >= timeInSec)
+            if (isFrameActual(m_timeMappingList[searchRezult].Time, timeInSec))
             {
                 break;
             }
@@ -227,7 +523,7 @@ VideoVectorBuffer::GetFramePtr(const unsigned long & msTime,
         {
             for (searchRezult = searchStart_1; searchRezult < searchEnd_1; searchRezult++)
             {
-                if (m_timeMappingList[searchRezult].Time >= timeInSec)
+                if (isFrameActual(m_timeMappingList[searchRezult].Time, timeInSec))
                 {
                     break;
                 }
@@ -242,10 +538,12 @@ VideoVectorBuffer::GetFramePtr(const unsigned long & msTime,
     {
         double      maxT            = -std::numeric_limits<double>::max();
         size_t      ui_maxT         = 0;
+        // In reverse direction the latest frame has minimal time
+        const double directionSign  = m_reverse ? -1.0 : 1.0;
         //
         for (size_t ui = 0; ui < m_timeMappingList.size(); ++ui)
         {
-            const double frameTimeMS = m_timeMappingList[ui].Time * 1000.0;
+            const double frameTimeMS = m_timeMappingList[ui].Time * 1000.0 * directionSign;
             if (frameTimeMS > maxT)
             {
                 maxT = frameTimeMS;
@@ -273,18 +571,21 @@ VideoVectorBuffer::GetFramePtr(const unsigned long & msTime,
             else
             {
                 float   frameDurationMS     = 1000.0f / m_fps;
+                const double    loopEndMS   = (double)m_videoLength * (m_loopGeneration + 1);
                 m_forcedFrameTimeMS         = msTime + frameDurationMS * 1;
-                if (m_forcedFrameTimeMS + frameDurationMS > m_videoLength)
-                    m_forcedFrameTimeMS = m_videoLength - frameDurationMS;
+                if (m_forcedFrameTimeMS + frameDurationMS > loopEndMS)
+                    m_forcedFrameTimeMS = loopEndMS - frameDurationMS;
 
                 // Use nearest (in time domain) frame
                 pArray = m_pool.m_ptr [ m_timeMappingList[ui_maxT].Ptr ];
+                m_lastFramePtr = pArray;
                 return 1;
             }
         }
 
     }
     pArray = m_pool.m_ptr [ m_timeMappingList[searchRezult].Ptr ];
+    m_lastFramePtr = pArray;
 
     //
     // Store pointer. It will be in use by ReleaseFoundFrame()
@@ -304,6 +605,84 @@ VideoVectorBuffer::ReleaseFoundFrame()
     m_bufferGrabPtrEnd = m_bufferGrabPtrEnd_found;
 }
 
+unsigned char *
+VideoVectorBuffer::lastFramePtr() const
+{
+    ScopedLock  lock (m_mutex);
+
+    return m_lastFramePtr;
+}
+
+const bool
+VideoVectorBuffer::isFrameReady(const unsigned long & msTime)
+{
+    if (m_fileIndex < 0)
+        return true;
+
+    ScopedLock          lock (m_mutex);
+
+    if (m_loop == false && msTime >= (double)m_videoLength * (m_loopGeneration + 1))
+        return true;
+
+    if (m_video_buffering_finished)
+        return true;
+    //
+    // Frames are searched in the same ranges as GetFramePtr() does
+    //
+    const double        timeInSec = (double)msTime / 1000.0;
+    const unsigned int  frameCount = m_pool.FrameCount();
+
+    if (m_bufferGrabPtrEnd != frameCount)
+    {
+        for (unsigned int i = m_bufferGrabPtrEnd; i < frameCount; ++i)
+        {
+            if (isFrameActual(m_timeMappingList[i].Time, timeInSec))
+                return true;
+        }
+    }
+    for (unsigned int i = 0; i < m_bufferGrabPtrStart; ++i)
+    {
+        if (isFrameActual(m_timeMappingList[i].Time, timeInSec))
+            return true;
+    }
+    return false;
+}
+
+const bool
+VideoVectorBuffer::releasePassedFrames(const unsigned long & msTime)
+{
+    if (m_fileIndex < 0)
+        return false;
+
+    ScopedLock          lock (m_mutex);
+    //
+    // Buffered frames follow the viewed frame till the grabbing position, wrapping at the end of the pool
+    //
+    const double        timeInSec = (double)msTime / 1000.0;
+    const unsigned int  frameCount = m_pool.FrameCount();
+    unsigned int        lastPassed = m_bufferGrabPtrEnd;
+    bool                isActualFound = false;
+
+    for (unsigned int i = m_bufferGrabPtrEnd; i < frameCount && isActualFound == false; ++i)
+    {
+        isActualFound = isFrameActual(m_timeMappingList[i].Time, timeInSec);
+        if (isActualFound == false)
+            lastPassed = i;
+    }
+    for (unsigned int i = 0; i < m_bufferGrabPtrStart && isActualFound == false; ++i)
+    {
+        isActualFound = isFrameActual(m_timeMappingList[i].Time, timeInSec);
+        if (isActualFound == false)
+            lastPassed = i;
+    }
+    const bool          isReleased = (lastPassed != m_bufferGrabPtrEnd);
+
+    m_bufferGrabPtrEnd = lastPassed;
+    m_bufferGrabPtrEnd_found = lastPassed;
+
+    return isReleased;
+}
+
 const unsigned int
 VideoVectorBuffer::freeSpaceSize() const
 {
@@ -342,6 +721,39 @@ VideoVectorBuffer::setStreamFinished(const bool value)
     m_video_buffering_finished = value;
 }
 
+void
+VideoVectorBuffer::setReverse(const bool reverse, const double & startTimeMS)
+{
+    ScopedLock  lock (m_mutex);
+
+    m_reverse = reverse;
+    m_reverseTimeMS = startTimeMS;
+}
+
+void
+VideoVectorBuffer::setLoop(const bool value)
+{
+    ScopedLock  lock (m_mutex);
+
+    m_loop = value;
+}
+
+void
+VideoVectorBuffer::setLoopGeneration(const unsigned int generation)
+{
+    ScopedLock  lock (m_mutex);
+
+    m_loopGeneration = generation;
+}
+
+const unsigned int
+VideoVectorBuffer::loopGeneration() const
+{
+    ScopedLock  lock (m_mutex);
+
+    return m_loopGeneration;
+}
+
 const bool
 VideoVectorBuffer::isStreamFinished()
 {
@@ -362,19 +774,65 @@ VideoVectorBuffer::writeFrame(const unsigned int & flag, const size_t & drop_fra
 
 
     double timeStampSec;
-    const short result = FFmpegWrapper::getNextImage (m_fileIndex,
-                                                    m_pool.m_ptr[loc_bufferGrabPtrStart],
-                                                    timeStampSec,
-                                                    drop_frame_nb,
-                                                    (flag & 1) ? false : true,
-                                                    m_forcedFrameTimeMS);
+    short  result;
+
+    if (m_reverse)
+    {
+        //
+        // Reverse playback walks backward frame by frame, decoder keeps current GOP in its cache
+        //
+        result = FFmpegWrapper::getPrevImage (m_fileIndex,
+                                             m_pool.m_ptr[loc_bufferGrabPtrStart],
+                                             timeStampSec,
+                                             m_reverseTimeMS);
+        if (result == 0)
+            m_reverseTimeMS = timeStampSec * 1000.0;
+    }
+    else
+    {
+        //
+        // Forced time is requested by playback clock, which is shifted by loop generation
+        //
+        double  forcedFrameTimeMS = m_forcedFrameTimeMS;
+        if (forcedFrameTimeMS >= 0.0)
+        {
+            forcedFrameTimeMS -= (double)m_videoLength * m_loopGeneration;
+            if (forcedFrameTimeMS < 0.0)
+                forcedFrameTimeMS = -1.0;
+        }
+        result = FFmpegWrapper::getNextImage (m_fileIndex,
+                                            m_pool.m_ptr[loc_bufferGrabPtrStart],
+                                            timeStampSec,
+                                            drop_frame_nb,
+                                            (flag & 1) ? false : true,
+                                            forcedFrameTimeMS);
+
+        if (result != 0 && m_loop)
+        {
+            //
+            // Looped stream continues from the start without flushing: frames of the previous pass
+            // are still in the buffer, so next frames get time of the next generation
+            //
+            unsigned long   startTimeMS = 0;
+
+            result = FFmpegWrapper::getImageFastNonAccurate (m_fileIndex, startTimeMS, m_pool.m_ptr[loc_bufferGrabPtrStart]);
+            if (result >= 0)
+            {
+                ScopedLock  lock (m_mutex);
+
+                timeStampSec = (double)startTimeMS / 1000.0;
+                ++m_loopGeneration;
+                result = 0;
+            }
+        }
+    }
 
 
     if (result == 0)
     {
         ScopedLock  lock (m_mutex);
 
-        m_timeMappingList[loc_bufferGrabPtrStart].Time = timeStampSec;
+        m_timeMappingList[loc_bufferGrabPtrStart].Time = timeStampSec + (double)m_videoLength * m_loopGeneration / 1000.0;
 
         m_bufferGrabPtrStart = loc_bufferGrabPtrStart + 1;
     }
@@ -20,6 +20,7 @@
 #include <OpenThreads/Thread>
 #include <OpenThreads/ScopedLock>
 #include "FFmpegFileHolder.hpp"
+#include "VideoMemoryManager.hpp"
 #include <vector>
 
 namespace osgFFmpeg {
@@ -38,12 +39,27 @@ class VideoVectorBuffer
             Time = lTime;
         }
     };
+    //
+    // Frames are placed in one contiguous slab with 64-byte aligned stride.
+    // Slab reserves memory for max frame number, if OS commits its pages lazily. Otherwise it is sized by quota.
+    // Only active frames(\m_ptr) are in use. Released slabs are recycled by other pools with the same slab size.
+    //
     struct MemoryPool
     {
-        std::vector<unsigned char *>    m_ptr;
+        std::vector<unsigned char *>    m_ptr;      // Active frames
+        std::vector<unsigned char *>    m_free;     // Reserved, but not active frames
+        unsigned char *                 m_slab;
+        size_t                          m_slabSize;
+        size_t                          m_stride;
         //
         //
         //
+        MemoryPool()
+        :m_slab(NULL),
+        m_slabSize(0),
+        m_stride(0)
+        {
+        }
         ~MemoryPool()
         {
             release();
@@ -52,42 +68,15 @@ class VideoVectorBuffer
         {
             return m_ptr.size();
         }
-        void release()
+        const size_t    Capacity() const
         {
-            size_t  i;
-            for (i=0; i < m_ptr.size(); ++i)
-            {
-                unsigned char * ptr = m_ptr[i];
-                av_free(ptr);
-            }
-            m_ptr.clear();
-        }
-        void alloc(const size_t & frameSize, const size_t & max_frame_nb)
-        {
-            try
-            {
-                size_t  i;
-                int     err = 0;
-                for (i=0; i < max_frame_nb && err == 0; ++i)
-                {
-                    unsigned char * ptr = (unsigned char *)av_malloc(frameSize);
-                    if (ptr != NULL)
-                    {
-                        memset (ptr, frameSize, 0); // Clear frame to avoid prev memory state
-                        m_ptr.push_back(ptr);
-                    }
-                    else
-                    {
-                        // interrupt allocation
-                        err = -1;
-                    }
-                }
-            }
-            catch (...)
-            {
-                // catch interrupted allocation
-            }
+            return (m_stride > 0) ? m_slabSize / m_stride : 0;
         }
+        void            release();
+        void            alloc(const size_t & frameSize, const size_t & frame_nb, const size_t & capacity);
+        // Change number of active frames. Remained frames keep their memory
+        void            resize(const size_t & frame_nb);
+        void            swap(MemoryPool & other);
     };
     typedef OpenThreads::Mutex              Mutex;
     typedef OpenThreads::ScopedLock<Mutex>  ScopedLock;
@@ -105,13 +94,28 @@ private:
     float                           m_fps;
     volatile double                 m_forcedFrameTimeMS;
     std::vector<TimedFramePointer>  m_timeMappingList;
+    bool                            m_reverse;              // Frames are grabbed and played in backward direction
+    double                          m_reverseTimeMS;        // Time before which next frame will be grabbed in reverse mode
+    unsigned char *                 m_lastFramePtr;         // Last frame returned by \GetFramePtr(). It is referenced by player's image
+    bool                            m_loop;                 // Forward grabbing continues from the start, when stream finished
+    unsigned int                    m_loopGeneration;       // Number of wraps of grabbing. Time of frames is shifted by it, so time keeps growing
+
+    // Frame is actual for [timeInSec], if it is not passed yet in the playback direction
+    const bool              isFrameActual(const double & frameTime, const double & timeInSec) const
+    {
+        return m_reverse ? (frameTime <= timeInSec) : (frameTime >= timeInSec);
+    }
+
+    // Number of frames reserved by the slab for [quota] frames
+    static const size_t     slabCapacity(const size_t & quota);
 
                             VideoVectorBuffer(const VideoVectorBuffer & other){}; // hide copy constructor
 public:
                             VideoVectorBuffer();
                             ~VideoVectorBuffer();
 
-    const int               alloc(const FFmpegFileHolder * pHolder);
+    // [listener] is notified, when quota of the buffer is changed by other buffers
+    const int               alloc(const FFmpegFileHolder * pHolder, VideoMemoryListener * listener = NULL);
     void                    flush();
     void                    release();
     void                    writeFrame(const unsigned int & flag, const size_t & drop_frame_nb);
@@ -124,6 +128,21 @@ public:
     const bool              isStreamFinished();
 
     void                    setStreamFinished(const bool value);
+    // Should be called after flush(), before grabbing starts
+    void                    setReverse(const bool reverse, const double & startTimeMS);
+
+    void                    setLoop(const bool value);
+    // Generation is kept by flush(). It should be set when grabbing starts from the new position
+    void                    setLoopGeneration(const unsigned int generation);
+    const unsigned int      loopGeneration() const;
+
+    // State of the buffer for VideoMemoryManager
+    void                    setPlaying(const bool value);
+    void                    setVisible(const bool value);
+    // Resize frame pool by quota of VideoMemoryManager. Should be called when grabbing and rendering are stopped.
+    // Returns true if pool has been resized, so buffered frames are flushed. Displayed frame is moved to
+    // the first frame(see \lastFramePtr()), because the pool could be reallocated.
+    const bool              applyMemoryQuota();
 
     /*
     * If Return value is 0(No error, and ptr are active), user SHOULD call ReleaseFoundFrame()
@@ -136,6 +155,12 @@ public:
     */
     const int               GetFramePtr(const unsigned long & msTime, unsigned char *& pArray, const bool useRibbonTimeStrategy);
     void                    ReleaseFoundFrame();
+    // Last frame returned by GetFramePtr()
+    unsigned char *         lastFramePtr() const;
+    // Frame of [msTime] is grabbed, or it will not be grabbed anymore. Offline rendering waits for it
+    const bool              isFrameReady(const unsigned long & msTime);
+    // Release buffered frames passed by [msTime] without rendering. Returns true if any frame is released
+    const bool              releasePassedFrames(const unsigned long & msTime);
 };
 
 } // namespace osgFFmpeg